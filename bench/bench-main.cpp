@@ -0,0 +1,32 @@
+﻿#include <cstdlib>      // atoi, EXIT_SUCCESS
+#include <iostream>
+#include <string>
+
+#include "benchmark.hpp"
+
+
+// cpp-utility-bench [filter] [--repetitions N] [--warmup N] [--csv]
+// Filter is substring of name of suite. Build in Release: timings of Debug are not meaningful.
+
+int main(int argc, char* argv[]) {
+    bench::Options options{};
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument{ argv[i] };
+        if (argument == "--csv") {
+            options.csv = true;
+        } else if (argument == "--repetitions" && i + 1 < argc) {
+            options.repetitions = std::atoi(argv[++i]);
+        } else if (argument == "--warmup" && i + 1 < argc) {
+            options.warmup = std::atoi(argv[++i]);
+        } else {
+            options.filter = argument;
+        }
+    }
+
+    bench::Runner runner{ options };
+    runner.PrintHeader();
+    for (const bench::Suite& suite : bench::Suites()) {
+        if (suite.name.find(options.filter) != std::string::npos) { suite.run(runner); }
+    }
+    return EXIT_SUCCESS;
+}
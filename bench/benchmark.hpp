@@ -0,0 +1,173 @@
+﻿#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <algorithm>    // sort, min
+#include <chrono>       // steady_clock
+#include <cstddef>      // size_t
+#include <functional>   // function
+#include <iomanip>      // setw, setprecision
+#include <iostream>
+#include <string>
+#include <utility>      // move
+#include <vector>
+
+
+/** Micro-benchmark framework of cpp-utility-bench. */
+namespace bench {
+
+    /**
+    * Barrier for optimizer: value is considered read, so computation of it is not removed.
+    * Value stays in register, if it is there, so barrier costs nothing in loop.
+    */
+    template<typename T>
+    inline void DoNotOptimize(const T& value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile char sink{};
+        sink = *reinterpret_cast<const volatile char*>(&value);
+#endif
+    }
+
+    /** Barrier for optimizer: all writes to memory are considered read. */
+    inline void ClobberMemory() noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : : "memory");
+#endif
+    }
+
+    struct Options {
+        /** Runs, that are not measured: caches, pages and threads of pool are warmed up. */
+        int warmup{ 2 };
+        int repetitions{ 10 };
+        /** Only suites, whose name contains filter, are run. */
+        std::string filter{};
+        /** Print results as CSV for tracking over time. */
+        bool csv{ false };
+    };
+
+    /** Statistics of repetitions, microseconds. */
+    struct Result {
+        std::string name{};
+        std::size_t threads{ 0 };
+        double median{ 0 };
+        double p10{ 0 };
+        double p90{ 0 };
+        double min{ 0 };
+        /** Median of baseline / median. 0 - there is no baseline. */
+        double speedup{ 0 };
+    };
+
+    /** Value of sorted samples at percent in [0, 100] by nearest rank. */
+    inline double Percentile(const std::vector<double>& sorted, double percent) noexcept {
+        if (sorted.empty()) { return 0; }
+        const double rank{ percent / 100.0 * static_cast<double>(sorted.size() - 1) };
+        return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(rank + 0.5))];
+    }
+
+    /**
+    * Runs benchmarks and prints results. Benchmark is function, whose every call is one measured run.
+    * Median is reported, because it is not moved by rare preemptions, p10 and p90 show noise.
+    */
+    class Runner {
+    public:
+        explicit Runner(Options options) : options_{ std::move(options) } {}
+
+        /** Median of this benchmark is baseline for speedup of next benchmarks of group. */
+        template<typename FuncT>
+        void Baseline(const std::string& name, FuncT&& func) {
+            baseline_ = Run(name, 1, std::forward<FuncT>(func)).median;
+        }
+
+        template<typename FuncT>
+        const Result& Run(const std::string& name, std::size_t threads, FuncT&& func) {
+            for (int i = 0; i < options_.warmup; ++i) { func(); }
+
+            std::vector<double> times{};
+            times.reserve(static_cast<std::size_t>(options_.repetitions));
+            for (int i = 0; i < options_.repetitions; ++i) {
+                const auto start{ std::chrono::steady_clock::now() };
+                func();
+                ClobberMemory();
+                const auto end{ std::chrono::steady_clock::now() };
+                times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+            }
+            std::sort(times.begin(), times.end());
+
+            Result result{ name, threads, Percentile(times, 50), Percentile(times, 10), Percentile(times, 90),
+                            times.empty() ? 0 : times.front(), 0 };
+            if (baseline_ > 0 && result.median > 0) { result.speedup = baseline_ / result.median; }
+            results_.push_back(result);
+            Print(result);
+            return results_.back();
+        }
+
+        /** Begin new group of benchmarks: its baseline is not set. */
+        void Group(const std::string& title) {
+            baseline_ = 0;
+            if (!options_.csv) { std::cout << '\n' << title << '\n'; }
+        }
+
+        const std::vector<Result>& results() const noexcept { return results_; }
+
+        void PrintHeader() const {
+            if (options_.csv) {
+                std::cout << "name,threads,median_us,p10_us,p90_us,min_us,speedup\n";
+            } else {
+                std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(8) << "threads"
+                        << std::setw(14) << "median us" << std::setw(14) << "p10 us" << std::setw(14) << "p90 us"
+                        << std::setw(10) << "speedup" << '\n';
+            }
+        }
+
+    private:
+        void Print(const Result& result) const {
+            if (options_.csv) {
+                std::cout << result.name << ',' << result.threads << ',' << result.median << ',' << result.p10 << ','
+                        << result.p90 << ',' << result.min << ',' << result.speedup << '\n';
+                return;
+            }
+            std::cout << std::left << std::setw(40) << result.name << std::right << std::setw(8) << result.threads
+                    << std::fixed << std::setprecision(1) << std::setw(14) << result.median << std::setw(14)
+                    << result.p10 << std::setw(14) << result.p90 << std::setprecision(2) << std::setw(10);
+            if (result.speedup > 0) {
+                std::cout << result.speedup << '\n';
+            } else {
+                std::cout << '-' << '\n';
+            }
+        }
+
+        Options options_;
+        std::vector<Result> results_{};
+        double baseline_{ 0 };
+    };
+
+
+    /** Benchmarks of one topic. Are registered by static Register objects of bench sources. */
+    struct Suite {
+        std::string name;
+        std::function<void(Runner&)> run;
+    };
+
+    inline std::vector<Suite>& Suites() {
+        static std::vector<Suite> suites{};
+        return suites;
+    }
+
+    struct Register {
+        Register(std::string name, std::function<void(Runner&)> run) {
+            Suites().push_back(Suite{ std::move(name), std::move(run) });
+        }
+    };
+
+    /** Thread counts for scaling: 1, 2, 4, ... and count of hardware threads. */
+    inline std::vector<std::size_t> ThreadCounts(std::size_t max_threads_count) {
+        std::vector<std::size_t> counts{};
+        for (std::size_t count = 1; count < max_threads_count; count *= 2) { counts.push_back(count); }
+        counts.push_back(max_threads_count == 0 ? 1 : max_threads_count);
+        return counts;
+    }
+
+} // !namespace bench
+
+#endif // !BENCHMARK_HPP
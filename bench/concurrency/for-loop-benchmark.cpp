@@ -0,0 +1,104 @@
+﻿#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "concurrency-support-library/multithreading.hpp"
+#include "concurrency-support-library/task-group.hpp"
+#include "concurrency-support-library/thread.hpp"
+
+
+// Parallel for loop evaluation: sequential loop against threads, for_parallel, tasks of pool and reduce.
+// Iterations are independent, there is no common resource.
+
+namespace {
+
+    constexpr std::size_t kIterationsCount{ 20'000'000 };
+
+    /** Cheap iteration, that optimizer can't remove: step of LCG, result is passed to DoNotOptimize. */
+    std::uint64_t DoSomething(std::size_t i, std::uint64_t x) noexcept {
+        return x * 6364136223846793005ull + i;
+    }
+
+    void ForLoop(std::size_t i, std::size_t imax) {
+        std::uint64_t x{ i };
+        for (; i < imax; ++i) { x = DoSomething(i, x); }
+        bench::DoNotOptimize(x);
+    }
+
+    /** Equal chunk per new thread: cost of creating threads on every loop. */
+    void MultiThreadForLoop(std::size_t threads_count) {
+        std::vector<std::thread> running_threads{};
+        const std::size_t len{ kIterationsCount / threads_count };
+        for (std::size_t thread = 0; thread < threads_count; ++thread) {
+            const std::size_t imax{ thread + 1 < threads_count ? (thread + 1) * len : kIterationsCount };
+            running_threads.emplace_back(&ForLoop, thread * len, imax);
+        }
+        for (auto& running_thread : running_threads) { running_thread.join(); }
+    }
+
+    void ForLoopBenchmarks(bench::Runner& runner) {
+        runner.Group("for loop of " + std::to_string(kIterationsCount) + " iterations");
+        runner.Baseline("sequential", []() { ForLoop(0, kIterationsCount); });
+
+        for (std::size_t threads_count : bench::ThreadCounts(std::thread::hardware_concurrency())) {
+            util::thread::ThreadPool pool{ threads_count };
+            runner.Run("std::thread per chunk", threads_count, [threads_count]() { MultiThreadForLoop(threads_count); });
+            runner.Run("for_parallel static", threads_count, [&pool]() {
+                conc::for_parallel(pool, conc::Schedule::Static(), &ForLoop, std::size_t{ 0 }, kIterationsCount);
+            });
+            runner.Run("for_parallel dynamic", threads_count, [&pool]() {
+                conc::for_parallel(pool, conc::Schedule::Dynamic(), &ForLoop, std::size_t{ 0 }, kIterationsCount);
+            });
+            runner.Run("for_parallel auto", threads_count, [&pool]() {
+                conc::for_parallel(pool, conc::Schedule::Auto(), &ForLoop, std::size_t{ 0 }, kIterationsCount);
+            });
+            runner.Run("task_group of 64 tasks", threads_count, [&pool]() {
+                constexpr std::size_t kTasksCount{ 64 };
+                conc::task_group group{ pool };
+                for (std::size_t task = 0; task < kTasksCount; ++task) {
+                    group.run([task]() {
+                        ForLoop(task * kIterationsCount / kTasksCount, (task + 1) * kIterationsCount / kTasksCount);
+                    });
+                }
+                group.wait();
+            });
+            runner.Run("parallel_reduce", threads_count, [&pool]() {
+                const std::uint64_t sum{ conc::parallel_reduce(pool, conc::Schedule::Static(), std::size_t{ 0 },
+                    kIterationsCount, std::uint64_t{ 0 },
+                    [](std::size_t i, std::size_t imax, std::uint64_t accumulator) {
+                        for (; i < imax; ++i) { accumulator = DoSomething(i, accumulator); }
+                        return accumulator;
+                    },
+                    [](std::uint64_t lhs, std::uint64_t rhs) { return lhs + rhs; }) };
+                bench::DoNotOptimize(sum);
+            });
+        }
+    }
+
+    /** Cost of scheduling: empty tasks, so time is only overhead of pool. */
+    void PoolBenchmarks(bench::Runner& runner) {
+        constexpr std::size_t kTasksCount{ 100'000 };
+        runner.Group("pool: " + std::to_string(kTasksCount) + " empty tasks");
+        for (std::size_t threads_count : bench::ThreadCounts(std::thread::hardware_concurrency())) {
+            util::thread::ThreadPool pool{ threads_count };
+            runner.Run("pool post from outside", threads_count, [&pool]() {
+                conc::task_group group{ pool };
+                for (std::size_t task = 0; task < kTasksCount; ++task) { group.run([]() {}); }
+                group.wait();
+            });
+            runner.Run("pool spawn from worker", threads_count, [&pool]() {
+                pool.submit([&pool]() {
+                    conc::task_group group{ pool };
+                    for (std::size_t task = 0; task < kTasksCount; ++task) { group.run([]() {}); }
+                    group.wait();
+                }).get();
+            });
+        }
+    }
+
+    const bench::Register kForLoop{ "for_parallel", &ForLoopBenchmarks };
+    const bench::Register kPool{ "pool", &PoolBenchmarks };
+
+} // !namespace
@@ -0,0 +1,39 @@
+﻿#include <cstddef>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "concurrency-support-library/parallel-scan.hpp"
+#include "concurrency-support-library/thread.hpp"
+
+
+// Parallel prefix sum against std::inclusive_scan. Scaling with count of threads.
+
+namespace {
+
+    constexpr std::size_t kScanSize{ 50'000'000 };
+
+    void ScanBenchmarks(bench::Runner& runner) {
+        std::vector<long long> values(kScanSize);
+        for (std::size_t i = 0; i < values.size(); ++i) { values[i] = static_cast<long long>(i % 7); }
+        std::vector<long long> expected(values.size());
+        std::vector<long long> result(values.size());
+
+        runner.Group("inclusive scan of " + std::to_string(kScanSize) + " elements");
+        runner.Baseline("std::inclusive_scan", [&values, &expected]() {
+            std::inclusive_scan(values.begin(), values.end(), expected.begin());
+        });
+        for (std::size_t threads_count : bench::ThreadCounts(std::thread::hardware_concurrency())) {
+            util::thread::ThreadPool pool{ threads_count };
+            runner.Run("parallel_inclusive_scan", threads_count, [&pool, &values, &result]() {
+                conc::parallel_inclusive_scan(pool, values.begin(), values.end(), result.begin());
+            });
+            if (result != expected) { std::cerr << "parallel_inclusive_scan: WRONG RESULT\n"; }
+        }
+    }
+
+    const bench::Register kScan{ "parallel_scan", &ScanBenchmarks };
+
+} // !namespace
@@ -7,8 +7,25 @@
 //concepts-library
 
 //concurrency-support-library
+#include "concurrency-support-library/blocked-range.hpp"
+#include "concurrency-support-library/combinable.hpp"
+#include "concurrency-support-library/coroutine-task.hpp"
+#include "concurrency-support-library/future.hpp"
+#include "concurrency-support-library/hardware.hpp"
+#include "concurrency-support-library/memory-reclamation.hpp"
+#include "concurrency-support-library/metrics.hpp"
 #include "concurrency-support-library/multithreading.hpp"
+#include "concurrency-support-library/parallel-find.hpp"
+#include "concurrency-support-library/parallel-region.hpp"
+#include "concurrency-support-library/parallel-scan.hpp"
+#include "concurrency-support-library/parallel-sort.hpp"
+#include "concurrency-support-library/slot-allocator.hpp"
+#include "concurrency-support-library/spsc-queue.hpp"
+#include "concurrency-support-library/task-group.hpp"
 #include "concurrency-support-library/thread.hpp"
+#include "concurrency-support-library/timer-wheel.hpp"
+#include "concurrency-support-library/topology.hpp"
+#include "concurrency-support-library/work-stealing-deque.hpp"
 
 //containers-library
 #include "containers-library/generic-container.hpp"
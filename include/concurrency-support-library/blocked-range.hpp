@@ -0,0 +1,278 @@
+﻿#ifndef BLOCKED_RANGE_HPP
+#define BLOCKED_RANGE_HPP
+
+#include <algorithm>	// min, max
+#include <array>
+#include <cmath>		// sqrt, cbrt
+#include <concepts>		// integral, invocable
+#include <cstddef>		// size_t
+#include <functional>	// invoke
+#include <type_traits>	// make_unsigned_t
+#include <utility>		// forward
+
+#include "concurrency-support-library/hardware.hpp"
+#include "concurrency-support-library/multithreading.hpp"
+#include "concurrency-support-library/thread.hpp"
+#include "concurrency-support-library/topology.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/**
+	* One dimension of index space: [begin, end) with grain - size of tile in this dimension.
+	* Grain 0 - tile size is chosen by parallel_for from cache size.
+	*/
+	template<std::integral IndexT>
+	class blocked_range {
+	public:
+		using value_type = IndexT;
+
+		constexpr blocked_range() noexcept = default;
+		constexpr blocked_range(IndexT begin, IndexT end, std::size_t grainsize = 0) noexcept
+			: begin_{ begin }, end_{ end }, grainsize_{ grainsize } {
+		}
+
+		constexpr IndexT begin() const noexcept { return begin_; }
+		constexpr IndexT end() const noexcept { return end_; }
+		constexpr std::size_t grainsize() const noexcept { return grainsize_; }
+		constexpr bool empty() const noexcept { return !(begin_ < end_); }
+
+		/** Count of indices. Difference of signed indices is computed in unsigned type, so it doesn't overflow. */
+		constexpr std::size_t size() const noexcept {
+			using UnsignedIndexT = std::make_unsigned_t<IndexT>;
+			return empty() ? 0 : static_cast<std::size_t>(static_cast<UnsignedIndexT>(end_)
+														- static_cast<UnsignedIndexT>(begin_));
+		}
+
+	private:
+		IndexT begin_{};
+		IndexT end_{};
+		std::size_t grainsize_{ 0 };
+	};
+
+	/** 2D index space: rows x cols. Cols are inner (contiguous in memory) dimension. */
+	template<std::integral IndexT>
+	class blocked_range2d {
+	public:
+		using value_type = IndexT;
+
+		constexpr blocked_range2d(blocked_range<IndexT> rows, blocked_range<IndexT> cols) noexcept
+			: rows_{ rows }, cols_{ cols } {
+		}
+		constexpr blocked_range2d(IndexT row_begin, IndexT row_end, std::size_t row_grainsize,
+								IndexT col_begin, IndexT col_end, std::size_t col_grainsize) noexcept
+			: rows_{ row_begin, row_end, row_grainsize }, cols_{ col_begin, col_end, col_grainsize } {
+		}
+		/** Tile size is chosen from cache size. */
+		constexpr blocked_range2d(IndexT row_begin, IndexT row_end, IndexT col_begin, IndexT col_end) noexcept
+			: rows_{ row_begin, row_end }, cols_{ col_begin, col_end } {
+		}
+
+		constexpr const blocked_range<IndexT>& rows() const noexcept { return rows_; }
+		constexpr const blocked_range<IndexT>& cols() const noexcept { return cols_; }
+		constexpr bool empty() const noexcept { return rows_.empty() || cols_.empty(); }
+
+	private:
+		blocked_range<IndexT> rows_;
+		blocked_range<IndexT> cols_;
+	};
+
+	/** 3D index space: pages x rows x cols. Cols are inner (contiguous in memory) dimension. */
+	template<std::integral IndexT>
+	class blocked_range3d {
+	public:
+		using value_type = IndexT;
+
+		constexpr blocked_range3d(blocked_range<IndexT> pages, blocked_range<IndexT> rows,
+								blocked_range<IndexT> cols) noexcept
+			: pages_{ pages }, rows_{ rows }, cols_{ cols } {
+		}
+		constexpr blocked_range3d(IndexT page_begin, IndexT page_end, std::size_t page_grainsize,
+								IndexT row_begin, IndexT row_end, std::size_t row_grainsize,
+								IndexT col_begin, IndexT col_end, std::size_t col_grainsize) noexcept
+			: pages_{ page_begin, page_end, page_grainsize },
+			rows_{ row_begin, row_end, row_grainsize },
+			cols_{ col_begin, col_end, col_grainsize } {
+		}
+		/** Tile size is chosen from cache size. */
+		constexpr blocked_range3d(IndexT page_begin, IndexT page_end, IndexT row_begin, IndexT row_end,
+								IndexT col_begin, IndexT col_end) noexcept
+			: pages_{ page_begin, page_end }, rows_{ row_begin, row_end }, cols_{ col_begin, col_end } {
+		}
+
+		constexpr const blocked_range<IndexT>& pages() const noexcept { return pages_; }
+		constexpr const blocked_range<IndexT>& rows() const noexcept { return rows_; }
+		constexpr const blocked_range<IndexT>& cols() const noexcept { return cols_; }
+		constexpr bool empty() const noexcept { return pages_.empty() || rows_.empty() || cols_.empty(); }
+
+	private:
+		blocked_range<IndexT> pages_;
+		blocked_range<IndexT> rows_;
+		blocked_range<IndexT> cols_;
+	};
+
+
+	namespace detail {
+		/** Dimensions of range from outer to inner. */
+		template<std::integral IndexT>
+		constexpr std::array<blocked_range<IndexT>, 1> Dimensions(const blocked_range<IndexT>& range) noexcept {
+			return { range };
+		}
+		template<std::integral IndexT>
+		constexpr std::array<blocked_range<IndexT>, 2> Dimensions(const blocked_range2d<IndexT>& range) noexcept {
+			return { range.rows(), range.cols() };
+		}
+		template<std::integral IndexT>
+		constexpr std::array<blocked_range<IndexT>, 3> Dimensions(const blocked_range3d<IndexT>& range) noexcept {
+			return { range.pages(), range.rows(), range.cols() };
+		}
+
+		template<std::integral IndexT>
+		constexpr blocked_range<IndexT> MakeRange(const std::array<blocked_range<IndexT>, 1>& dims) noexcept {
+			return dims[0];
+		}
+		template<std::integral IndexT>
+		constexpr blocked_range2d<IndexT> MakeRange(const std::array<blocked_range<IndexT>, 2>& dims) noexcept {
+			return { dims[0], dims[1] };
+		}
+		template<std::integral IndexT>
+		constexpr blocked_range3d<IndexT> MakeRange(const std::array<blocked_range<IndexT>, 3>& dims) noexcept {
+			return { dims[0], dims[1], dims[2] };
+		}
+
+		/** Size of elements, that is assumed for tile size from cache: double or pointer. */
+		inline constexpr std::size_t kTileElementSize{ 8 };
+
+		/** Half of L2: the other half stays for data, that is read around tile (neighbours of stencil, other matrix). */
+		inline std::size_t TileCacheBudget() {
+			static const std::size_t budget{ DataCacheSize(2) / 2 };
+			return budget;
+		}
+
+		/**
+		* Fill zero grains, so tile of elements of element_size fits into cache_bytes.
+		* Tile is close to cube: it has the least border for the volume. Inner dimension is rounded up to whole
+		* cache lines, so neighbour tiles don't share lines. Outer dimension is divided at least into
+		* min_tiles parts, so every thread gets work.
+		*/
+		template<std::integral IndexT, std::size_t kDims>
+		std::array<std::size_t, kDims> TileSizes(const std::array<blocked_range<IndexT>, kDims>& dims,
+												std::size_t element_size, std::size_t cache_bytes,
+												std::size_t min_tiles = 1) noexcept {
+			const std::size_t line_elements{ std::max<std::size_t>(1, kCacheLineSize / std::max<std::size_t>(1, element_size)) };
+			std::size_t budget{ std::max<std::size_t>(line_elements, cache_bytes / std::max<std::size_t>(1, element_size)) };
+
+			std::array<std::size_t, kDims> tiles{};
+			for (std::size_t dim = kDims; dim-- > 0;) { // from inner to outer
+				const std::size_t size{ std::max<std::size_t>(1, dims[dim].size()) };
+				std::size_t tile{ dims[dim].grainsize() };
+				if (tile == 0) {
+					const std::size_t outer_dims{ dim + 1 }; // budget is shared with outer dimensions
+					const double side{ outer_dims == 1 ? static_cast<double>(budget)
+										: outer_dims == 2 ? std::sqrt(static_cast<double>(budget))
+										: std::cbrt(static_cast<double>(budget)) };
+					tile = std::max<std::size_t>(1, static_cast<std::size_t>(side));
+					if (dim + 1 == kDims) { tile = (tile + line_elements - 1) / line_elements * line_elements; }
+					if (dim == 0 && min_tiles > 1) { tile = std::min(tile, (size + min_tiles - 1) / min_tiles); }
+				}
+				tiles[dim] = std::min(tile, size);
+				budget = std::max<std::size_t>(1, budget / tiles[dim]);
+			}
+			return tiles;
+		}
+	} // !namespace detail
+
+
+	/**
+	* Range with zero grains replaced by tile sizes, so one tile of elements fits into cache.
+	*
+	* @param element_size		bytes of data per index: sum of sizes of elements of all arrays, that body touches
+	* @param cache_bytes		size of cache for one tile. By default half of L2
+	*/
+	template<typename RangeT>
+	RangeT cache_tiled(const RangeT& range, std::size_t element_size, std::size_t cache_bytes = detail::TileCacheBudget()) {
+		auto dims{ detail::Dimensions(range) };
+		const auto tiles{ detail::TileSizes(dims, element_size, cache_bytes) };
+		for (std::size_t dim = 0; dim < dims.size(); ++dim) {
+			dims[dim] = { dims[dim].begin(), dims[dim].end(), tiles[dim] };
+		}
+		return detail::MakeRange(dims);
+	}
+
+	/**
+	* Parallel loop over tiles of 1D, 2D or 3D index space. body(const RangeT& tile) gets subrange of the same type.
+	* Tiles are numbered from outer dimension to inner, and numbers are divided by schedule among the same
+	* participants, as in for_parallel: caller thread and workers of pool. Static schedule gives every thread
+	* band of neighbour tiles.
+	* Tile size is grainsize of dimension. Zero grains are derived from cache size for 8 bytes per index:
+	* use cache_tiled() for other sizes of data.
+	*
+	* Typical body: for (int r = tile.rows().begin(); r < tile.rows().end(); ++r)
+	*					for (int c = tile.cols().begin(); c < tile.cols().end(); ++c) {}
+	*/
+	template<typename RangeT, typename BodyT>
+		requires std::invocable<BodyT&, const RangeT&>
+	void parallel_for(util::thread::ThreadPool& pool, Schedule schedule, const RangeT& range, BodyT&& body) {
+		using IndexT = typename RangeT::value_type;
+		using UnsignedIndexT = std::make_unsigned_t<IndexT>;
+		if (range.empty()) { return; }
+
+		const auto dims{ detail::Dimensions(range) };
+		constexpr std::size_t kDims{ std::tuple_size_v<decltype(dims)> };
+		const auto tiles{ detail::TileSizes(dims, detail::kTileElementSize, detail::TileCacheBudget(), pool.size()) };
+
+		std::array<std::size_t, kDims> tiles_counts{};
+		std::size_t tiles_count{ 1 };
+		for (std::size_t dim = 0; dim < kDims; ++dim) {
+			tiles_counts[dim] = (dims[dim].size() + tiles[dim] - 1) / tiles[dim];
+			tiles_count *= tiles_counts[dim];
+		}
+
+		/** Subrange of tile number. The last tile of dimension may be smaller. */
+		auto make_tile = [&dims, &tiles, &tiles_counts](std::size_t tile) noexcept {
+			std::array<blocked_range<IndexT>, kDims> tile_dims{};
+			for (std::size_t dim = kDims; dim-- > 0;) {
+				const std::size_t first{ tile % tiles_counts[dim] * tiles[dim] };
+				const std::size_t last{ std::min(first + tiles[dim], dims[dim].size()) };
+				tile /= tiles_counts[dim];
+				const UnsignedIndexT begin{ static_cast<UnsignedIndexT>(dims[dim].begin()) };
+				tile_dims[dim] = { static_cast<IndexT>(begin + static_cast<UnsignedIndexT>(first)),
+								static_cast<IndexT>(begin + static_cast<UnsignedIndexT>(last)), tiles[dim] };
+			}
+			return detail::MakeRange(tile_dims);
+		};
+
+		detail::RangeScheduler<std::size_t> scheduler{ 0, tiles_count, 1, schedule };
+		const std::size_t participants_count{ detail::ParticipantsCount(pool, tiles_count) };
+		scheduler.set_participants_count(participants_count);
+
+		detail::RunParticipants(pool, participants_count, [&scheduler, &body, &make_tile](std::size_t participant) {
+			std::size_t round{ 0 };
+			std::size_t chunk_begin{ 0 };
+			std::size_t chunk_end{ 0 };
+			while (scheduler.Next(participant, round, chunk_begin, chunk_end)) {
+				for (std::size_t tile = chunk_begin; tile < chunk_end; ++tile) {
+					std::invoke(body, make_tile(tile));
+				}
+			}
+		});
+	}
+
+	/** Parallel loop over tiles with static schedule on pool. */
+	template<typename RangeT, typename BodyT>
+		requires std::invocable<BodyT&, const RangeT&>
+	void parallel_for(util::thread::ThreadPool& pool, const RangeT& range, BodyT&& body) {
+		parallel_for(pool, Schedule::Static(), range, std::forward<BodyT>(body));
+	}
+
+	/** Parallel loop over tiles with static schedule on DefaultThreadPool(). */
+	template<typename RangeT, typename BodyT>
+		requires std::invocable<BodyT&, const RangeT&>
+	void parallel_for(const RangeT& range, BodyT&& body) {
+		parallel_for(util::thread::DefaultThreadPool(), Schedule::Static(), range, std::forward<BodyT>(body));
+	}
+
+} // !namespace conc
+
+#endif // !BLOCKED_RANGE_HPP
@@ -0,0 +1,176 @@
+﻿#ifndef COMBINABLE_HPP
+#define COMBINABLE_HPP
+
+#include <atomic>
+#include <concepts>		// invocable, convertible_to
+#include <cstddef>		// size_t
+#include <functional>	// function, invoke
+#include <memory>		// unique_ptr, make_unique
+#include <optional>
+#include <thread>		// this_thread::get_id
+#include <type_traits>	// invoke_result_t
+#include <utility>		// move, forward, as_const
+
+#include "concurrency-support-library/hardware.hpp"
+#include "concurrency-support-library/thread.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/**
+	* Instance of T per thread, that are combined after parallel work. Like tbb::combinable.
+	* Scratch buffers and partial results of for_parallel body don't need mutex or thread_local globals.
+	*
+	* Instance is created on the first local() of thread by init function. Instances of workers of pool are in
+	* array, indexed by worker, so local() of worker is index check and load, without locks and atomics.
+	* Other threads (caller of for_parallel, workers of other pools) have instances in lock-free list.
+	* Every instance is padded to cache line: threads don't share lines, when they modify own instance.
+	*
+	* local() may be called concurrently by any threads. combine(), for_each() and clear() must not run
+	* concurrently with local(): they are called after parallel work.
+	*
+	* Example:
+	* conc::combinable<long long> sums{ pool };
+	* conc::for_parallel(pool, [&sums](int i, int imax) { for (; i < imax; ++i) { sums.local() += i; } }, 0, n);
+	* const long long sum{ sums.combine(std::plus<>{}) };
+	*/
+	template<typename T>
+	class combinable {
+	public:
+		/** Instances are value initialized. */
+		combinable() : combinable(util::thread::DefaultThreadPool()) {}
+
+		/** Instances are value initialized. Instances of workers of pool are found without search. */
+		explicit combinable(util::thread::ThreadPool& pool) : combinable(pool, []() { return T{}; }) {}
+
+		/** @param init		T(). Creates instance of thread */
+		template<std::invocable InitT>
+			requires std::convertible_to<std::invoke_result_t<InitT&>, T>
+		explicit combinable(InitT init) : combinable(util::thread::DefaultThreadPool(), std::move(init)) {}
+
+		template<std::invocable InitT>
+			requires std::convertible_to<std::invoke_result_t<InitT&>, T>
+		combinable(util::thread::ThreadPool& pool, InitT init)
+			: pool_{ pool }, init_{ std::move(init) },
+			workers_count_{ pool.size() }, workers_{ std::make_unique<WorkerSlot[]>(pool.size()) } {
+		}
+
+		combinable(const combinable&) = delete;
+		combinable& operator=(const combinable&) = delete;
+		combinable(combinable&&) noexcept = delete;
+		combinable& operator=(combinable&&) noexcept = delete;
+
+		~combinable() { clear(); }
+
+		/** Instance of current thread. Is created on the first call. */
+		T& local() {
+			bool exists{ false };
+			return local(exists);
+		}
+
+		/** @param exists		false, if instance was created by this call */
+		T& local(bool& exists) {
+			const std::size_t worker_index{ pool_.current_worker_index() };
+			if (worker_index != util::thread::ThreadPool::kNotWorker) {
+				std::optional<T>& slot{ workers_[worker_index].value };
+				exists = slot.has_value();
+				if (!exists) { slot.emplace(std::invoke(init_)); }
+				return *slot;
+			}
+			return ExternalLocal(exists);
+		}
+
+		/**
+		* Combine all instances by binary operation: op(op(a, b), c)...
+		*
+		* @param op		T(T, T). Must be associative
+		* @return		result of init function, if no instance was created
+		*/
+		template<typename BinaryOpT>
+			requires std::invocable<BinaryOpT&, T, T>
+		T combine(BinaryOpT op) const {
+			std::optional<T> result{};
+			for_each([&result, &op](const T& value) {
+				if (result) {
+					result.emplace(std::invoke(op, std::move(*result), value));
+				} else {
+					result.emplace(value);
+				}
+			});
+			return result ? std::move(*result) : std::invoke(init_);
+		}
+
+		/** Call func(T&) for every instance: workers in order of index, then other threads. */
+		template<typename FuncT>
+		void for_each(FuncT&& func) {
+			for (std::size_t i = 0; i < workers_count_; ++i) {
+				if (workers_[i].value) { std::invoke(func, *workers_[i].value); }
+			}
+			for (ExternalSlot* slot{ external_.load(std::memory_order_acquire) }; slot; slot = slot->next_) {
+				std::invoke(func, slot->value_);
+			}
+		}
+
+		/** Call func(const T&) for every instance. */
+		template<typename FuncT>
+		void for_each(FuncT&& func) const {
+			for (std::size_t i = 0; i < workers_count_; ++i) {
+				if (workers_[i].value) { std::invoke(func, std::as_const(*workers_[i].value)); }
+			}
+			for (const ExternalSlot* slot{ external_.load(std::memory_order_acquire) }; slot; slot = slot->next_) {
+				std::invoke(func, slot->value_);
+			}
+		}
+
+		/** Destroy all instances. Next local() creates new ones. */
+		void clear() noexcept {
+			for (std::size_t i = 0; i < workers_count_; ++i) { workers_[i].value.reset(); }
+			for (ExternalSlot* slot{ external_.exchange(nullptr, std::memory_order_acquire) }; slot;) {
+				std::unique_ptr<ExternalSlot> owner{ slot };
+				slot = slot->next_;
+			}
+		}
+
+	private:
+		using WorkerSlot = CacheLinePadded<std::optional<T>>;
+
+		/** Instance of thread, that is not worker of pool. */
+		struct alignas(kCacheLineSize) ExternalSlot {
+			template<typename... ArgsT>
+			explicit ExternalSlot(std::thread::id id, ArgsT&&... args) : id_{ id }, value_( std::forward<ArgsT>(args)... ) {}
+
+			const std::thread::id id_;
+			T value_;
+			ExternalSlot* next_{ nullptr };
+		};
+
+		/** Slots are only added, so search is lock-free. Usually there is one external thread: caller of loop. */
+		T& ExternalLocal(bool& exists) {
+			const std::thread::id id{ std::this_thread::get_id() };
+			ExternalSlot* head{ external_.load(std::memory_order_acquire) };
+			for (ExternalSlot* slot{ head }; slot; slot = slot->next_) {
+				if (slot->id_ == id) {
+					exists = true;
+					return slot->value_;
+				}
+			}
+			exists = false;
+			auto slot{ std::make_unique<ExternalSlot>(id, std::invoke(init_)) };
+			slot->next_ = head;
+			while (!external_.compare_exchange_weak(slot->next_, slot.get(), std::memory_order_release,
+													std::memory_order_acquire)) {
+			}
+			return slot.release()->value_;
+		}
+
+		util::thread::ThreadPool& pool_;
+		std::function<T()> init_;
+		const std::size_t workers_count_;
+		std::unique_ptr<WorkerSlot[]> workers_;
+		std::atomic<ExternalSlot*> external_{ nullptr };
+	}; // !class combinable
+
+} // !namespace conc
+
+#endif // !COMBINABLE_HPP
@@ -0,0 +1,373 @@
+﻿#ifndef COROUTINE_TASK_HPP
+#define COROUTINE_TASK_HPP
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>		// size_t
+#include <exception>	// exception_ptr, terminate
+#include <optional>
+#include <semaphore>	// binary_semaphore
+#include <tuple>
+#include <type_traits>	// conditional_t, is_void_v, remove_reference_t
+#include <utility>		// move, exchange, index_sequence
+#include <variant>		// monostate
+#include <vector>
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	template<typename T = void>
+	class task;
+
+	namespace detail {
+
+		/**
+		* Common part of promise of task.
+		* Task starts lazily, when it is awaited. Awaiting coroutine is continuation.
+		* Awaiter and final awaiter of task race for flag: who comes second, continues awaiting coroutine.
+		* Task, that finished synchronously inside await_suspend, leaves flag to awaiter, and awaiter doesn't
+		* suspend. So long chains of synchronous tasks don't grow stack without tail calls of compiler (-O0, -O1).
+		* Task, that finished on other thread, resumes continuation by symmetric transfer.
+		*/
+		class TaskPromiseBase {
+		public:
+			struct FinalAwaiter {
+				bool await_ready() const noexcept { return false; }
+				template<typename PromiseT>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> handle) noexcept {
+					TaskPromiseBase& promise{ handle.promise() };
+					if (promise.ready_.exchange(true, std::memory_order_acq_rel)) { return promise.continuation_; }
+					return std::noop_coroutine(); // awaiter is in await_suspend yet, it continues itself
+				}
+				void await_resume() const noexcept {}
+			};
+
+			std::suspend_always initial_suspend() const noexcept { return {}; }
+			FinalAwaiter final_suspend() const noexcept { return {}; }
+			void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+			/**
+			* Start task and continue awaiting coroutine, when task is finished.
+			*
+			* @return		false, if task finished synchronously: awaiting coroutine continues without suspend
+			*/
+			bool Start(std::coroutine_handle<> handle, std::coroutine_handle<> continuation) noexcept {
+				continuation_ = continuation;
+				handle.resume();
+				return !ready_.exchange(true, std::memory_order_acq_rel);
+			}
+
+		protected:
+			void RethrowIfFailed() const {
+				if (exception_) { std::rethrow_exception(exception_); }
+			}
+
+		private:
+			std::coroutine_handle<> continuation_{};
+			std::exception_ptr exception_{};
+			/** Set by the first of awaiter and final awaiter. */
+			std::atomic<bool> ready_{ false };
+		};
+
+		template<typename T>
+		class TaskPromise final : public TaskPromiseBase {
+		public:
+			task<T> get_return_object() noexcept;
+
+			template<typename ValueT>
+			void return_value(ValueT&& value) { value_.emplace(std::forward<ValueT>(value)); }
+
+			T& Result() & {
+				RethrowIfFailed();
+				return *value_;
+			}
+			T&& Result() && {
+				RethrowIfFailed();
+				return std::move(*value_);
+			}
+
+		private:
+			std::optional<T> value_{};
+		};
+
+		template<>
+		class TaskPromise<void> final : public TaskPromiseBase {
+		public:
+			task<void> get_return_object() noexcept;
+
+			void return_void() const noexcept {}
+
+			void Result() const { RethrowIfFailed(); }
+		};
+
+	} // !namespace detail
+
+
+	/**
+	* Lazy coroutine with result of type T.
+	* Task starts, when it is awaited: co_await some_task. Result or exception is passed to awaiting coroutine.
+	* To continue on thread pool: co_await pool.schedule(). To wait from usual function: sync_wait(task).
+	*
+	* Example:
+	* conc::task<int> Parse(util::thread::ThreadPool& pool, std::string text) {
+	*	co_await pool.schedule();
+	*	co_return std::stoi(text);
+	* }
+	*/
+	template<typename T>
+	class [[nodiscard]] task {
+	public:
+		using promise_type = detail::TaskPromise<T>;
+		using value_type = T;
+
+		task() noexcept = default;
+		explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle_{ handle } {}
+
+		task(const task&) = delete;
+		task& operator=(const task&) = delete;
+
+		task(task&& other) noexcept : handle_{ std::exchange(other.handle_, nullptr) } {}
+		task& operator=(task&& other) noexcept {
+			if (this != &other) {
+				if (handle_) { handle_.destroy(); }
+				handle_ = std::exchange(other.handle_, nullptr);
+			}
+			return *this;
+		}
+
+		~task() {
+			if (handle_) { handle_.destroy(); }
+		}
+
+		/** Task is finished. */
+		bool is_ready() const noexcept { return !handle_ || handle_.done(); }
+
+		/** Start task and get reference to result, when it is finished. */
+		auto operator co_await() & noexcept { return Awaiter<false>{ handle_ }; }
+
+		/** Start task and get result, when it is finished. */
+		auto operator co_await() && noexcept { return Awaiter<true>{ handle_ }; }
+
+	private:
+		template<bool kMoveResult>
+		struct Awaiter {
+			bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+			/** Task, that finished synchronously, returns here, and awaiting coroutine doesn't suspend. */
+			bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+				return handle_.promise().Start(handle_, awaiting);
+			}
+
+			decltype(auto) await_resume() {
+				if constexpr (kMoveResult) {
+					return std::move(handle_.promise()).Result();
+				} else {
+					return handle_.promise().Result();
+				}
+			}
+
+			std::coroutine_handle<promise_type> handle_;
+		};
+
+		std::coroutine_handle<promise_type> handle_{};
+	}; // !class task
+
+
+	namespace detail {
+
+		template<typename T>
+		task<T> TaskPromise<T>::get_return_object() noexcept {
+			return task<T>{ std::coroutine_handle<TaskPromise<T>>::from_promise(*this) };
+		}
+
+		inline task<void> TaskPromise<void>::get_return_object() noexcept {
+			return task<void>{ std::coroutine_handle<TaskPromise<void>>::from_promise(*this) };
+		}
+
+		/** Result of task<void> is stored as monostate. */
+		template<typename T>
+		using NonVoidT = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+		/**
+		* Coroutine, that awaits task and calls callback, when task is finished.
+		* Callback returns coroutine, that is resumed by symmetric transfer.
+		*/
+		class TaskDriver {
+		public:
+			using DoneFuncT = std::coroutine_handle<> (*)(void* context) noexcept;
+
+			struct promise_type {
+				struct FinalAwaiter {
+					bool await_ready() const noexcept { return false; }
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+						promise_type& promise{ handle.promise() };
+						return promise.done_func_(promise.context_);
+					}
+					void await_resume() const noexcept {}
+				};
+
+				TaskDriver get_return_object() noexcept {
+					return TaskDriver{ std::coroutine_handle<promise_type>::from_promise(*this) };
+				}
+				std::suspend_always initial_suspend() const noexcept { return {}; }
+				FinalAwaiter final_suspend() const noexcept { return {}; }
+				void return_void() const noexcept {}
+				void unhandled_exception() const noexcept { std::terminate(); } // driver catches all
+
+				DoneFuncT done_func_{ nullptr };
+				void* context_{ nullptr };
+			};
+
+			explicit TaskDriver(std::coroutine_handle<promise_type> handle) noexcept : handle_{ handle } {}
+			TaskDriver(const TaskDriver&) = delete;
+			TaskDriver& operator=(const TaskDriver&) = delete;
+			TaskDriver(TaskDriver&& other) noexcept : handle_{ std::exchange(other.handle_, nullptr) } {}
+			TaskDriver& operator=(TaskDriver&&) noexcept = delete;
+			~TaskDriver() {
+				if (handle_) { handle_.destroy(); }
+			}
+
+			void Start(DoneFuncT done_func, void* context) {
+				handle_.promise().done_func_ = done_func;
+				handle_.promise().context_ = context;
+				handle_.resume();
+			}
+
+		private:
+			std::coroutine_handle<promise_type> handle_;
+		};
+
+		template<typename T>
+		TaskDriver MakeTaskDriver(task<T>& awaited, std::optional<NonVoidT<T>>& result, std::exception_ptr& exception) {
+			try {
+				if constexpr (std::is_void_v<T>) {
+					co_await std::move(awaited);
+					result.emplace();
+				} else {
+					result.emplace(co_await std::move(awaited));
+				}
+			} catch (...) {
+				exception = std::current_exception();
+			}
+		}
+
+		/**
+		* Counter of unfinished tasks of when_all.
+		* Is started from count + 1: awaiting coroutine is the last participant, so task, that is finished
+		* before all tasks are started, can't resume awaiting coroutine.
+		*/
+		class WhenAllCounter {
+		public:
+			explicit WhenAllCounter(std::size_t count) noexcept : count_{ count + 1 } {}
+
+			/** @return		false, if all tasks are finished already: awaiting coroutine continues at once */
+			bool TrySuspend(std::coroutine_handle<> awaiting) noexcept {
+				awaiting_ = awaiting;
+				return count_.fetch_sub(1, std::memory_order_acq_rel) > 1;
+			}
+
+			static std::coroutine_handle<> Arrive(void* context) noexcept {
+				auto* counter{ static_cast<WhenAllCounter*>(context) };
+				if (counter->count_.fetch_sub(1, std::memory_order_acq_rel) == 1) { return counter->awaiting_; }
+				return std::noop_coroutine();
+			}
+
+		private:
+			std::atomic<std::size_t> count_;
+			std::coroutine_handle<> awaiting_{};
+		};
+
+		/** Start all drivers, than suspend until all of them are finished. */
+		template<typename DriversT>
+		struct WhenAllAwaiter {
+			bool await_ready() const noexcept { return false; }
+			bool await_suspend(std::coroutine_handle<> awaiting) {
+				for (TaskDriver& driver : drivers_) { driver.Start(&WhenAllCounter::Arrive, &counter_); }
+				return counter_.TrySuspend(awaiting);
+			}
+			void await_resume() const noexcept {}
+
+			DriversT& drivers_;
+			WhenAllCounter& counter_;
+		};
+
+		inline void RethrowFirst(const std::vector<std::exception_ptr>& exceptions) {
+			for (const std::exception_ptr& exception : exceptions) {
+				if (exception) { std::rethrow_exception(exception); }
+			}
+		}
+
+		template<typename... T, std::size_t... kIndices>
+		task<std::tuple<NonVoidT<T>...>> WhenAll(std::index_sequence<kIndices...>, task<T>... tasks) {
+			std::tuple<std::optional<NonVoidT<T>>...> results{};
+			std::vector<std::exception_ptr> exceptions(sizeof...(T));
+			std::vector<TaskDriver> drivers{};
+			drivers.reserve(sizeof...(T));
+			(drivers.push_back(MakeTaskDriver(tasks, std::get<kIndices>(results), exceptions[kIndices])), ...);
+
+			WhenAllCounter counter{ sizeof...(T) };
+			co_await WhenAllAwaiter<std::vector<TaskDriver>>{ drivers, counter };
+			RethrowFirst(exceptions);
+			co_return std::tuple<NonVoidT<T>...>{ std::move(*std::get<kIndices>(results))... };
+		}
+
+	} // !namespace detail
+
+
+	/**
+	* Run tasks concurrently and wait all of them. Tasks are started one by one on current thread, they run in
+	* parallel, if they continue on pool. The first exception (by order of arguments) is rethrown.
+	*
+	* @return		tuple of results, std::monostate for task<void>
+	*/
+	template<typename... T>
+	task<std::tuple<detail::NonVoidT<T>...>> when_all(task<T>... tasks) {
+		return detail::WhenAll(std::index_sequence_for<T...>{}, std::move(tasks)...);
+	}
+
+	/** @return		results in order of tasks. task<void> for tasks without result */
+	template<typename T>
+	task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<task<T>> tasks) {
+		std::vector<std::optional<detail::NonVoidT<T>>> results(tasks.size());
+		std::vector<std::exception_ptr> exceptions(tasks.size());
+		std::vector<detail::TaskDriver> drivers{};
+		drivers.reserve(tasks.size());
+		for (std::size_t i = 0; i < tasks.size(); ++i) {
+			drivers.push_back(detail::MakeTaskDriver(tasks[i], results[i], exceptions[i]));
+		}
+
+		detail::WhenAllCounter counter{ tasks.size() };
+		co_await detail::WhenAllAwaiter<std::vector<detail::TaskDriver>>{ drivers, counter };
+		detail::RethrowFirst(exceptions);
+		if constexpr (!std::is_void_v<T>) {
+			std::vector<T> values{};
+			values.reserve(results.size());
+			for (auto& result : results) { values.push_back(std::move(*result)); }
+			co_return values;
+		}
+	}
+
+	/**
+	* Start task and block current thread until task is finished. Bridge from usual code to coroutines.
+	* Don't call from worker of pool, that task continues on: worker is blocked.
+	*/
+	template<typename T>
+	T sync_wait(task<T> awaited) {
+		std::optional<detail::NonVoidT<T>> result{};
+		std::exception_ptr exception{};
+		std::binary_semaphore done{ 0 };
+		detail::TaskDriver driver{ detail::MakeTaskDriver(awaited, result, exception) };
+		driver.Start([](void* context) noexcept -> std::coroutine_handle<> {
+			static_cast<std::binary_semaphore*>(context)->release();
+			return std::noop_coroutine();
+		}, &done);
+		done.acquire();
+
+		if (exception) { std::rethrow_exception(exception); }
+		if constexpr (!std::is_void_v<T>) { return std::move(*result); }
+	}
+
+} // !namespace conc
+
+#endif // !COROUTINE_TASK_HPP
@@ -0,0 +1,190 @@
+﻿#ifndef FUTURE_HPP
+#define FUTURE_HPP
+
+#include <atomic>
+#include <cstddef>		// size_t
+#include <cstdint>		// uint32_t
+#include <memory>		// unique_ptr
+#include <tuple>
+#include <type_traits>	// decay_t, invoke_result_t, is_nothrow_move_constructible_v
+#include <utility>		// move, forward
+#include <vector>
+
+#include "concurrency-support-library/thread.hpp"
+
+
+namespace util {
+
+	namespace thread {
+
+		namespace detail {
+
+			template<typename FuncT>
+			auto MakeReadyFuture(FuncT&& func) -> TaskFuture<std::invoke_result_t<std::decay_t<FuncT>&>> {
+				using ReturnT = std::invoke_result_t<std::decay_t<FuncT>&>;
+				auto* task{ new FutureTask<std::decay_t<FuncT>, ReturnT>(std::forward<FuncT>(func)) };
+				TaskFuture<ReturnT> result{ task };
+				task->Run();
+				return result;
+			}
+
+			/**
+			* State of when_all and when_any. Owns input futures and attaches Arrival task to every of them.
+			* when_all is published by the last arrival, when_any by the first one.
+			* Thread, that attaches arrivals, is participant too, so result is not published before all
+			* arrivals are attached.
+			*
+			* Owners of when_all state: result future and completion.
+			* Owners of when_any state: result future, every arrival and attaching thread.
+			*/
+			template<typename ResultT, typename SequenceT, bool kAny>
+			class CombinatorState final : public FutureState<ResultT> {
+			public:
+				CombinatorState(SequenceT futures, std::size_t count)
+					: FutureState<ResultT>(kAny ? static_cast<std::uint32_t>(count + 2) : 2),
+					  futures_{ std::move(futures) },
+					  count_{ count },
+					  remaining_{ count + 1 } {
+				}
+
+				/** States are collected before: result may be published and futures moved during attaching. */
+				void Start(const std::vector<FutureStateBase*>& states) {
+					for (std::size_t index = 0; index < states.size(); ++index) {
+						states[index]->SetContinuation(new Arrival{ *this, index });
+					}
+					Arrive(kNoIndex);
+				}
+
+				void Run() override {} // is completed by arrivals
+
+			private:
+				static constexpr std::size_t kNoIndex{ static_cast<std::size_t>(-1) };
+
+				class Arrival final : public TaskBase {
+				public:
+					Arrival(CombinatorState& owner, std::size_t index) noexcept : owner_{ owner }, index_{ index } {}
+
+					void Run() override {
+						std::unique_ptr<Arrival> self{ this };
+						owner_.Arrive(index_);
+					}
+
+				private:
+					CombinatorState& owner_;
+					std::size_t index_;
+				};
+
+				void Arrive(std::size_t index) noexcept {
+					if constexpr (kAny) {
+						const bool first_ready{ index != kNoIndex || count_ == 0 };
+						if (first_ready && !published_.exchange(true, std::memory_order_acq_rel)) {
+							PublishResult(index);
+						}
+						this->Release();
+					} else {
+						if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+							PublishResult(index);
+							this->Release();
+						}
+					}
+				}
+
+				void PublishResult(std::size_t index) noexcept {
+					auto collect = [this, index]() noexcept(std::is_nothrow_move_constructible_v<SequenceT>) -> ResultT {
+						if constexpr (kAny) {
+							return ResultT{ index, std::move(futures_) };
+						} else {
+							static_cast<void>(index);
+							return std::move(futures_);
+						}
+					};
+					this->Complete(collect);
+					this->Publish();
+				}
+
+				SequenceT futures_;
+				const std::size_t count_;
+				std::atomic<std::size_t> remaining_;
+				std::atomic<bool> published_{ false };
+			};
+
+			template<typename ResultT, bool kAny, typename SequenceT>
+			TaskFuture<ResultT> Combine(SequenceT futures, const std::vector<FutureStateBase*>& states) {
+				auto* state{ new CombinatorState<ResultT, SequenceT, kAny>(std::move(futures), states.size()) };
+				TaskFuture<ResultT> result{ state };
+				state->Start(states);
+				return result;
+			}
+
+		} // !namespace detail
+
+	} // !namespace thread
+
+} // !namespace util
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/** Future of task of pool with continuations: then(), when_all(), when_any(). */
+	template<typename T>
+	using future = util::thread::TaskFuture<T>;
+
+	/** Result of when_any: index of the first ready future and all futures. */
+	template<typename SequenceT>
+	struct when_any_result {
+		std::size_t index{ static_cast<std::size_t>(-1) };
+		SequenceT futures{};
+	};
+
+	/** Future, that is ready already. Continuations of it are executed at once. */
+	template<typename T>
+	future<std::decay_t<T>> make_ready_future(T&& value) {
+		return util::thread::detail::MakeReadyFuture([value = std::forward<T>(value)]() mutable
+				noexcept(std::is_nothrow_move_constructible_v<std::decay_t<T>>) {
+			return std::move(value);
+		});
+	}
+
+	inline future<void> make_ready_future() {
+		return util::thread::detail::MakeReadyFuture([]() noexcept {});
+	}
+
+	/**
+	* Future, that becomes ready, when all futures are ready. No thread waits: the last completed task
+	* publishes result.
+	*
+	* @return		future of the same futures, all of them are ready
+	*/
+	template<typename T>
+	future<std::vector<future<T>>> when_all(std::vector<future<T>> futures) {
+		std::vector<util::thread::detail::FutureStateBase*> states{};
+		states.reserve(futures.size());
+		for (future<T>& input : futures) { states.push_back(util::thread::detail::FutureAccess::State(input)); }
+		return util::thread::detail::Combine<std::vector<future<T>>, false>(std::move(futures), states);
+	}
+
+	template<typename... T>
+	future<std::tuple<future<T>...>> when_all(future<T>... futures) {
+		std::vector<util::thread::detail::FutureStateBase*> states{
+			util::thread::detail::FutureAccess::State(futures)... };
+		return util::thread::detail::Combine<std::tuple<future<T>...>, false>(
+			std::tuple<future<T>...>{ std::move(futures)... }, states);
+	}
+
+	/**
+	* Future, that becomes ready, when any future is ready.
+	*
+	* @return		index of the first ready future and all futures. Index is -1 for empty vector
+	*/
+	template<typename T>
+	future<when_any_result<std::vector<future<T>>>> when_any(std::vector<future<T>> futures) {
+		std::vector<util::thread::detail::FutureStateBase*> states{};
+		states.reserve(futures.size());
+		for (future<T>& input : futures) { states.push_back(util::thread::detail::FutureAccess::State(input)); }
+		return util::thread::detail::Combine<when_any_result<std::vector<future<T>>>, true>(std::move(futures), states);
+	}
+
+} // !namespace conc
+
+#endif // !FUTURE_HPP
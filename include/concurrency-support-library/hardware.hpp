@@ -0,0 +1,51 @@
+﻿#ifndef HARDWARE_HPP
+#define HARDWARE_HPP
+
+#include <cstddef>	// size_t
+#include <thread>	// yield
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>		// _mm_pause
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>	// _mm_pause
+#endif
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/**
+	* Size of cache line, that is used for padding of data, modified by different threads.
+	* Two atomics on one cache line make false sharing: every write of one thread invalidates line in cache of other.
+	* std::hardware_destructive_interference_size is not stable between compilers, so constant is fixed.
+	*/
+	inline constexpr std::size_t kCacheLineSize{ 64 };
+
+	/**
+	* Value, that occupies whole cache lines. Array of padded values has no false sharing,
+	* when every thread modifies only own element.
+	*/
+	template<typename T>
+	struct alignas(kCacheLineSize) CacheLinePadded {
+		T value{};
+	};
+
+	/**
+	* Hint to processor, that thread is in spin-wait loop.
+	* Decrease power consumption and memory order violation penalty on exit from loop.
+	*/
+	inline void CpuRelax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		asm volatile("yield" ::: "memory");
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+} // !namespace conc
+
+#endif // !HARDWARE_HPP
@@ -0,0 +1,484 @@
+﻿#ifndef MEMORY_RECLAMATION_HPP
+#define MEMORY_RECLAMATION_HPP
+
+#include <algorithm>	// sort, binary_search, find, find_if, max, remove_if, stable_partition
+#include <array>
+#include <atomic>
+#include <cstddef>		// size_t
+#include <cstdint>		// uint64_t, uint32_t
+#include <mutex>		// mutex, lock_guard
+#include <stdexcept>	// length_error
+#include <utility>		// exchange
+#include <vector>
+
+#include "concurrency-support-library/hardware.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	namespace detail {
+		/** Object, that is removed from structure, but can be read by other threads yet. */
+		struct RetiredObject {
+			void* pointer_;
+			void (*deleter_)(void*);
+			/** Epoch domain: global epoch at retire. */
+			std::uint64_t epoch_;
+		};
+
+		inline void DeleteRetired(std::vector<RetiredObject>& retired) noexcept {
+			for (const RetiredObject& object : retired) { object.deleter_(object.pointer_); }
+			retired.clear();
+		}
+
+		/** Free objects, that can be freed. Deleters are called after list is updated, so they may retire objects. */
+		template<typename PredicateT>
+		void FreeRetired(std::vector<RetiredObject>& retired, PredicateT can_free) {
+			const auto kept_end{ std::stable_partition(retired.begin(), retired.end(),
+														[&can_free](const RetiredObject& object) { return !can_free(object); }) };
+			std::vector<RetiredObject> freed(kept_end, retired.end());
+			retired.erase(kept_end, retired.end());
+			DeleteRetired(freed);
+		}
+
+		template<typename T>
+		void DeleteObject(void* pointer) noexcept { delete static_cast<T*>(pointer); }
+
+		/** State of one thread in one domain. Record of exited thread is reused by next thread. */
+		struct alignas(kCacheLineSize) ThreadRecord {
+			ThreadRecord() = default;
+			ThreadRecord(const ThreadRecord&) = delete;
+			ThreadRecord& operator=(const ThreadRecord&) = delete;
+			ThreadRecord(ThreadRecord&&) noexcept = delete;
+			ThreadRecord& operator=(ThreadRecord&&) noexcept = delete;
+			virtual ~ThreadRecord() = default;
+
+			std::atomic<bool> in_use_{ true };
+			/** Next record of domain. Is set once, before record is published. */
+			ThreadRecord* next_{ nullptr };
+			/** Retired objects of thread. Only owner thread works with them. */
+			std::vector<RetiredObject> retired_{};
+			/** Size of retired_, that triggers next collection. Grows, while objects can't be freed. */
+			std::size_t collect_at_{ 0 };
+		};
+
+		/**
+		* Records of threads of one domain. Thread takes record on the first use of domain and gives it back on exit.
+		* Records are removed only by destructor of domain, so reclaimers traverse list without locks.
+		* Current thread finds own record in thread-local cache: the last used domain is one comparison.
+		*
+		* Thread may exit after domain is destroyed, and domain may be destroyed before thread exits. Registry of
+		* live domains with one mutex orders them: it is taken only on thread exit and on creation of domain.
+		*/
+		class ThreadRecords {
+		public:
+			ThreadRecords() {
+				Registry& registry{ GetRegistry() };
+				std::lock_guard<std::mutex> lock{ registry.mutex_ };
+				id_ = ++registry.last_id_;
+				registry.live_.push_back(id_);
+			}
+
+			ThreadRecords(const ThreadRecords&) = delete;
+			ThreadRecords& operator=(const ThreadRecords&) = delete;
+			ThreadRecords(ThreadRecords&&) noexcept = delete;
+			ThreadRecords& operator=(ThreadRecords&&) noexcept = delete;
+
+			/** No thread may read objects of domain. All retired objects are freed. */
+			~ThreadRecords() {
+				{
+					Registry& registry{ GetRegistry() };
+					std::lock_guard<std::mutex> lock{ registry.mutex_ };
+					registry.live_.erase(std::find(registry.live_.begin(), registry.live_.end(), id_));
+				}
+				for (ThreadRecord* record{ head_.load(std::memory_order_acquire) }; record;) {
+					DeleteRetired(record->retired_);
+					delete std::exchange(record, record->next_);
+				}
+				DeleteRetired(orphans_);
+			}
+
+			/** Record of current thread. */
+			template<typename RecordT>
+			RecordT& Local() {
+				LocalRecords& local{ Locals() };
+				if (local.last_id_ != id_) {
+					const auto entry{ std::find_if(local.entries_.begin(), local.entries_.end(),
+													[this](const LocalEntry& other) { return other.id_ == id_; }) };
+					if (entry != local.entries_.end()) {
+						local.last_record_ = entry->record_;
+					} else {
+						local.Prune();
+						local.entries_.reserve(local.entries_.size() + 1);
+						local.last_record_ = &Acquire<RecordT>();
+						local.entries_.push_back(LocalEntry{ id_, this, local.last_record_ });
+					}
+					local.last_id_ = id_;
+				}
+				return static_cast<RecordT&>(*local.last_record_);
+			}
+
+			ThreadRecord* head() const noexcept { return head_.load(std::memory_order_acquire); }
+
+			/** Move retired objects of exited threads to list of current thread. */
+			void AdoptOrphans(std::vector<RetiredObject>& retired) {
+				if (!has_orphans_.load(std::memory_order_acquire)) { return; }
+				std::lock_guard<std::mutex> lock{ orphans_mutex_ };
+				retired.insert(retired.end(), orphans_.begin(), orphans_.end());
+				orphans_.clear();
+				has_orphans_.store(false, std::memory_order_relaxed);
+			}
+
+		private:
+			/** Ids of live domains. Is never destroyed: threads may exit after static destructors. */
+			struct Registry {
+				std::mutex mutex_{};
+				std::vector<std::uint64_t> live_{};
+				std::uint64_t last_id_{ 0 };
+			};
+
+			struct LocalEntry {
+				std::uint64_t id_;
+				ThreadRecords* records_;
+				ThreadRecord* record_;
+			};
+
+			/** Records of current thread in all domains, that it used. */
+			struct LocalRecords {
+				LocalRecords() = default;
+				LocalRecords(const LocalRecords&) = delete;
+				LocalRecords& operator=(const LocalRecords&) = delete;
+				LocalRecords(LocalRecords&&) noexcept = delete;
+				LocalRecords& operator=(LocalRecords&&) noexcept = delete;
+
+				/** Exiting thread gives records back to domains, that are alive. */
+				~LocalRecords() {
+					Registry& registry{ GetRegistry() };
+					std::lock_guard<std::mutex> lock{ registry.mutex_ };
+					for (const LocalEntry& entry : entries_) {
+						if (std::find(registry.live_.begin(), registry.live_.end(), entry.id_) != registry.live_.end()) {
+							entry.records_->Release(*entry.record_);
+						}
+					}
+				}
+
+				/** Forget domains, that were destroyed. Ids are not reused, so dead entry never matches. */
+				void Prune() {
+					Registry& registry{ GetRegistry() };
+					std::lock_guard<std::mutex> lock{ registry.mutex_ };
+					entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [&registry](const LocalEntry& entry) {
+						return std::find(registry.live_.begin(), registry.live_.end(), entry.id_) == registry.live_.end();
+					}), entries_.end());
+				}
+
+				std::uint64_t last_id_{ 0 };
+				ThreadRecord* last_record_{ nullptr };
+				std::vector<LocalEntry> entries_{};
+			};
+
+			static Registry& GetRegistry() {
+				static Registry* registry{ new Registry{} };
+				return *registry;
+			}
+
+			static LocalRecords& Locals() noexcept {
+				thread_local LocalRecords locals{};
+				return locals;
+			}
+
+			/** Take free record or add new one to list. */
+			template<typename RecordT>
+			RecordT& Acquire() {
+				for (ThreadRecord* record{ head() }; record; record = record->next_) {
+					bool in_use{ false };
+					if (!record->in_use_.load(std::memory_order_relaxed)
+						&& record->in_use_.compare_exchange_strong(in_use, true, std::memory_order_acquire)) {
+						return static_cast<RecordT&>(*record);
+					}
+				}
+				RecordT* record{ new RecordT{} };
+				ThreadRecord* head{ head_.load(std::memory_order_relaxed) };
+				do {
+					record->next_ = head;
+				} while (!head_.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+				return *record;
+			}
+
+			/** Is called by exiting thread under mutex of registry, so domain is not destroyed meanwhile. */
+			void Release(ThreadRecord& record) noexcept {
+				if (!record.retired_.empty()) {
+					std::lock_guard<std::mutex> lock{ orphans_mutex_ };
+					try {
+						orphans_.insert(orphans_.end(), record.retired_.begin(), record.retired_.end());
+						has_orphans_.store(true, std::memory_order_release);
+					} catch (...) { // no memory for list: objects are freed by destructor of domain
+						return;
+					}
+					record.retired_.clear();
+				}
+				record.collect_at_ = 0;
+				record.in_use_.store(false, std::memory_order_release);
+			}
+
+			std::uint64_t id_{ 0 };
+			std::atomic<ThreadRecord*> head_{ nullptr };
+
+			/** Retired objects of exited threads. */
+			std::mutex orphans_mutex_{};
+			std::vector<RetiredObject> orphans_{};
+			std::atomic<bool> has_orphans_{ false };
+		}; // !class ThreadRecords
+	} // !namespace detail
+
+
+	/**
+	* Epoch-based reclamation (Fraser). Readers of lock-free structure enter critical section by pin(): thread
+	* announces global epoch in own record, and this exchange with fence is all cost of read side. No counters of
+	* references are changed on objects, so readers don't write shared cache lines.
+	*
+	* Object, that is unlinked from structure, is retired with current global epoch into list of thread.
+	* Global epoch advances, when all pinned threads announced it. Object, retired in epoch e, is freed,
+	* when global epoch reaches e + 2: all threads, that could see it, left critical sections.
+	* Retired objects are freed by batches: every kBatchSize retires thread tries to advance epoch and frees its list.
+	*
+	* Thread, that is pinned for long time, stops reclamation in all threads: memory grows until it unpins.
+	* HazardPointerDomain bounds memory in this case, but costs more on read side.
+	*
+	* Example:
+	* {
+	*	auto guard{ domain.pin() };
+	*	Node* node{ head.load(std::memory_order_acquire) }; // node is not freed, while guard lives
+	* }
+	* Node* old{ head.exchange(new_node) };
+	* domain.retire(old);
+	*/
+	class EpochDomain {
+		struct Record;
+
+	public:
+		static constexpr std::size_t kBatchSize{ 64 };
+
+		/** Critical section of reader. Guards may be nested. Must be destroyed by the thread, that created it. */
+		class [[nodiscard]] guard {
+		public:
+			guard(const guard&) = delete;
+			guard& operator=(const guard&) = delete;
+			guard(guard&&) noexcept = delete;
+			guard& operator=(guard&&) noexcept = delete;
+
+			~guard() {
+				if (--record_.nesting_ == 0) { record_.epoch_.store(0, std::memory_order_release); }
+			}
+
+		private:
+			friend class EpochDomain;
+
+			explicit guard(Record& record) noexcept : record_{ record } {}
+
+			Record& record_;
+		};
+
+		EpochDomain() = default;
+		EpochDomain(const EpochDomain&) = delete;
+		EpochDomain& operator=(const EpochDomain&) = delete;
+		EpochDomain(EpochDomain&&) noexcept = delete;
+		EpochDomain& operator=(EpochDomain&&) noexcept = delete;
+
+		/** No thread may be pinned. All retired objects are freed. */
+		~EpochDomain() = default;
+
+		/** Enter critical section: objects, that are reachable now, are not freed until guard is destroyed. */
+		guard pin() {
+			Record& record{ records_.Local<Record>() };
+			if (record.nesting_++ == 0) {
+				// Exchange continues release sequence of unpin, so reclaimer, that sees new epoch, sees end of
+				// previous critical section. Fence: announcement is seen before reads of structure
+				record.epoch_.exchange(epoch_.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+			return guard{ record };
+		}
+
+		/** Free object by delete, when no reader can see it. Object must be unlinked from structure already. */
+		template<typename T>
+		void retire(T* pointer) {
+			retire(pointer, &detail::DeleteObject<T>);
+		}
+
+		/** Free object by deleter, when no reader can see it. */
+		void retire(void* pointer, void (*deleter)(void*)) {
+			Record& record{ records_.Local<Record>() };
+			std::atomic_thread_fence(std::memory_order_seq_cst); // unlink is seen before epoch is read
+			record.retired_.push_back(detail::RetiredObject{ pointer, deleter, epoch_.load(std::memory_order_relaxed) });
+			if (record.retired_.size() >= std::max(kBatchSize, record.collect_at_)) { Collect(record); }
+		}
+
+		/** Try to advance epoch and free retired objects of current thread and of exited threads. */
+		void collect() { Collect(records_.Local<Record>()); }
+
+		/** Global epoch. Starts from 1. */
+		std::uint64_t epoch() const noexcept { return epoch_.load(std::memory_order_relaxed); }
+
+	private:
+		struct Record final : detail::ThreadRecord {
+			/** Announced epoch. 0 - thread is not pinned. */
+			std::atomic<std::uint64_t> epoch_{ 0 };
+			std::size_t nesting_{ 0 };
+		};
+
+		/** Advance epoch, if all pinned threads announced current one. */
+		bool TryAdvance() noexcept {
+			std::uint64_t epoch{ epoch_.load(std::memory_order_relaxed) };
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			for (detail::ThreadRecord* record{ records_.head() }; record; record = record->next_) {
+				// Acquire: critical sections, that ended, happen before free
+				const std::uint64_t announced{ static_cast<Record*>(record)->epoch_.load(std::memory_order_acquire) };
+				if (announced != 0 && announced != epoch) { return false; }
+			}
+			return epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel, std::memory_order_relaxed);
+		}
+
+		void Collect(Record& record) {
+			records_.AdoptOrphans(record.retired_);
+			TryAdvance();
+			const std::uint64_t epoch{ epoch_.load(std::memory_order_acquire) };
+			detail::FreeRetired(record.retired_, [epoch](const detail::RetiredObject& object) {
+				return object.epoch_ + 2 <= epoch;
+			});
+			record.collect_at_ = 2 * record.retired_.size(); // amortized: stuck objects are not checked on every retire
+		}
+
+		alignas(kCacheLineSize) std::atomic<std::uint64_t> epoch_{ 1 };
+		detail::ThreadRecords records_{};
+	}; // !class EpochDomain
+
+
+	/**
+	* Hazard pointers (Michael). Reader publishes pointer, that it is going to read, in hazard slot of its thread,
+	* and checks, that pointer is still in structure. Retired object is freed, when no slot holds it.
+	* Unlike EpochDomain, stalled reader keeps only objects, that it protects, so memory is bounded. Read costs
+	* store with fence per object.
+	*
+	* Retired objects are freed by batches: thread collects hazards of all threads, sorts them once and frees
+	* objects of its list, that are not protected.
+	*
+	* Example:
+	* auto hazard{ domain.make_hazard_pointer() };
+	* Node* node{ hazard.protect(head) }; // node is not freed, while hazard holds it
+	*/
+	class HazardPointerDomain {
+		struct Record;
+
+	public:
+		/** Hazard pointers of one thread, that may exist at the same time. */
+		static constexpr std::size_t kHazardsCount{ 4 };
+		static constexpr std::size_t kBatchSize{ 64 };
+
+		/** Slot of current thread. Must be used and destroyed by the thread, that created it. */
+		class [[nodiscard]] hazard_pointer {
+		public:
+			hazard_pointer(const hazard_pointer&) = delete;
+			hazard_pointer& operator=(const hazard_pointer&) = delete;
+			hazard_pointer(hazard_pointer&&) noexcept = delete;
+			hazard_pointer& operator=(hazard_pointer&&) noexcept = delete;
+
+			~hazard_pointer() {
+				reset();
+				record_.used_ &= ~(1u << index_);
+			}
+
+			/**
+			* Load pointer from source and protect it.
+			*
+			* @return		pointer, that was in source after it was protected. Is valid until reset()
+			*/
+			template<typename T>
+			T* protect(const std::atomic<T*>& source) noexcept {
+				T* pointer{ source.load(std::memory_order_relaxed) };
+				while (true) {
+					record_.hazards_[index_].exchange(pointer, std::memory_order_seq_cst); // continues release sequence of reset
+					T* current{ source.load(std::memory_order_seq_cst) };
+					if (current == pointer) { return pointer; }
+					pointer = current;
+				}
+			}
+
+			/** Object is not protected anymore. */
+			void reset() noexcept { record_.hazards_[index_].store(nullptr, std::memory_order_release); }
+
+		private:
+			friend class HazardPointerDomain;
+
+			hazard_pointer(Record& record, std::uint32_t index) noexcept : record_{ record }, index_{ index } {}
+
+			Record& record_;
+			const std::uint32_t index_;
+		};
+
+		HazardPointerDomain() = default;
+		HazardPointerDomain(const HazardPointerDomain&) = delete;
+		HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+		HazardPointerDomain(HazardPointerDomain&&) noexcept = delete;
+		HazardPointerDomain& operator=(HazardPointerDomain&&) noexcept = delete;
+
+		/** No object may be protected. All retired objects are freed. */
+		~HazardPointerDomain() = default;
+
+		/** @throw std::length_error		current thread holds kHazardsCount hazard pointers already */
+		hazard_pointer make_hazard_pointer() {
+			Record& record{ records_.Local<Record>() };
+			for (std::uint32_t index = 0; index < kHazardsCount; ++index) {
+				if ((record.used_ & (1u << index)) == 0) {
+					record.used_ |= 1u << index;
+					return hazard_pointer{ record, index };
+				}
+			}
+			throw std::length_error{ "HazardPointerDomain: too many hazard pointers of thread" };
+		}
+
+		/** Free object by delete, when no hazard pointer holds it. Object must be unlinked from structure already. */
+		template<typename T>
+		void retire(T* pointer) {
+			retire(pointer, &detail::DeleteObject<T>);
+		}
+
+		/** Free object by deleter, when no hazard pointer holds it. */
+		void retire(void* pointer, void (*deleter)(void*)) {
+			Record& record{ records_.Local<Record>() };
+			record.retired_.push_back(detail::RetiredObject{ pointer, deleter, 0 });
+			if (record.retired_.size() >= std::max(kBatchSize, record.collect_at_)) { Collect(record); }
+		}
+
+		/** Free retired objects of current thread and of exited threads, that are not protected. */
+		void collect() { Collect(records_.Local<Record>()); }
+
+	private:
+		struct Record final : detail::ThreadRecord {
+			std::array<std::atomic<void*>, kHazardsCount> hazards_{};
+			/** Mask of slots, that are taken by hazard pointers. */
+			std::uint32_t used_{ 0 };
+		};
+
+		void Collect(Record& record) {
+			records_.AdoptOrphans(record.retired_);
+			std::atomic_thread_fence(std::memory_order_seq_cst); // unlink is seen before hazards are read
+			std::vector<void*> hazards{};
+			for (detail::ThreadRecord* other{ records_.head() }; other; other = other->next_) {
+				for (const std::atomic<void*>& hazard : static_cast<Record*>(other)->hazards_) {
+					if (void* pointer{ hazard.load(std::memory_order_acquire) }) { hazards.push_back(pointer); }
+				}
+			}
+			std::sort(hazards.begin(), hazards.end());
+
+			detail::FreeRetired(record.retired_, [&hazards](const detail::RetiredObject& object) {
+				return !std::binary_search(hazards.begin(), hazards.end(), object.pointer_);
+			});
+			record.collect_at_ = 2 * record.retired_.size();
+		}
+
+		detail::ThreadRecords records_{};
+	}; // !class HazardPointerDomain
+
+} // !namespace conc
+
+#endif // !MEMORY_RECLAMATION_HPP
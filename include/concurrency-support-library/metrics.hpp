@@ -0,0 +1,136 @@
+﻿#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <algorithm>	// min, max
+#include <array>
+#include <atomic>
+#include <bit>			// bit_width
+#include <cmath>		// ceil
+#include <cstddef>		// size_t
+#include <cstdint>		// uint64_t
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	class LatencyRecorder;
+
+	/**
+	* Histogram of latencies in HDR style: log-linear buckets. Values below kSubBucketsCount are exact,
+	* bigger values are grouped by power of two, and every power is divided into kSubBucketsCount buckets,
+	* so relative error is not more than 1 / kSubBucketsCount for any value up to 2^64.
+	* Plain value: it is result of snapshot and can be merged.
+	*/
+	class LatencyHistogram {
+	public:
+		static constexpr std::size_t kSubBucketsBits{ 3 };
+		static constexpr std::size_t kSubBucketsCount{ std::size_t{ 1 } << kSubBucketsBits };
+		static constexpr std::size_t kBucketsCount{ (64 - kSubBucketsBits + 1) * kSubBucketsCount };
+
+		static constexpr std::size_t BucketIndex(std::uint64_t value) noexcept {
+			if (value < kSubBucketsCount) { return static_cast<std::size_t>(value); }
+			const std::size_t shift{ static_cast<std::size_t>(std::bit_width(value)) - 1 - kSubBucketsBits };
+			return (shift + 1) * kSubBucketsCount + static_cast<std::size_t>((value >> shift) & (kSubBucketsCount - 1));
+		}
+
+		/** The greatest value of bucket. */
+		static constexpr std::uint64_t BucketUpperBound(std::size_t index) noexcept {
+			if (index < kSubBucketsCount) { return index; }
+			const std::size_t shift{ index / kSubBucketsCount - 1 };
+			const std::uint64_t lower{ (kSubBucketsCount + index % kSubBucketsCount) << shift };
+			return lower + ((std::uint64_t{ 1 } << shift) - 1);
+		}
+
+		void record(std::uint64_t value, std::uint64_t count = 1) noexcept {
+			counts_[BucketIndex(value)] += count;
+			count_ += count;
+			sum_ += value * count;
+			max_ = std::max(max_, value);
+		}
+
+		void merge(const LatencyHistogram& other) noexcept {
+			for (std::size_t i = 0; i < kBucketsCount; ++i) { counts_[i] += other.counts_[i]; }
+			count_ += other.count_;
+			sum_ += other.sum_;
+			max_ = std::max(max_, other.max_);
+		}
+
+		std::uint64_t count() const noexcept { return count_; }
+		std::uint64_t max() const noexcept { return max_; }
+		double mean() const noexcept { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_); }
+
+		/**
+		* @param percent		in [0, 100]: 50 - median, 99 - p99
+		* @return				upper bound of bucket of percentile, not more than max. 0 for empty histogram
+		*/
+		std::uint64_t percentile(double percent) const noexcept {
+			if (count_ == 0) { return 0; }
+			const double rank{ std::ceil(std::min(std::max(percent, 0.0), 100.0) / 100.0 * static_cast<double>(count_)) };
+			const std::uint64_t target{ std::max<std::uint64_t>(1, static_cast<std::uint64_t>(rank)) };
+			std::uint64_t accumulated{ 0 };
+			for (std::size_t i = 0; i < kBucketsCount; ++i) {
+				accumulated += counts_[i];
+				if (accumulated >= target) { return std::min(BucketUpperBound(i), max_); }
+			}
+			return max_;
+		}
+
+		std::uint64_t bucket_count(std::size_t index) const noexcept { return counts_[index]; }
+
+	private:
+		friend class LatencyRecorder;
+
+		std::array<std::uint64_t, kBucketsCount> counts_{};
+		std::uint64_t count_{ 0 };
+		std::uint64_t sum_{ 0 };
+		std::uint64_t max_{ 0 };
+	};
+
+
+	/**
+	* Counter, that is written by one thread and read by any thread. Increment is load and store without
+	* lock prefix, so it costs as plain increment.
+	*/
+	class SingleWriterCounter {
+	public:
+		void add(std::uint64_t value = 1) noexcept { store(load() + value); }
+		void store(std::uint64_t value) noexcept { value_.store(value, std::memory_order_relaxed); }
+		std::uint64_t load() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<std::uint64_t> value_{ 0 };
+	};
+
+
+	/**
+	* LatencyHistogram, that is written by one thread and read by any thread.
+	* snapshot() is not atomic as a whole: value, that is recorded during reading, may be counted partly.
+	*/
+	class LatencyRecorder {
+	public:
+		void record(std::uint64_t value) noexcept {
+			counts_[LatencyHistogram::BucketIndex(value)].add();
+			sum_.add(value);
+			if (value > max_.load()) { max_.store(value); }
+		}
+
+		LatencyHistogram snapshot() const noexcept {
+			LatencyHistogram histogram{};
+			for (std::size_t i = 0; i < LatencyHistogram::kBucketsCount; ++i) {
+				histogram.counts_[i] = counts_[i].load();
+				histogram.count_ += histogram.counts_[i];
+			}
+			histogram.sum_ = sum_.load();
+			histogram.max_ = max_.load();
+			return histogram;
+		}
+
+	private:
+		std::array<SingleWriterCounter, LatencyHistogram::kBucketsCount> counts_{};
+		SingleWriterCounter sum_{};
+		SingleWriterCounter max_{};
+	};
+
+} // !namespace conc
+
+#endif // !METRICS_HPP
@@ -1,47 +1,469 @@
 ﻿#ifndef MULTITHREADING_HPP
 #define MULTITHREADING_HPP
 
-#include <vector>
-#include <thread>
+#include <algorithm>    // min, max
+#include <array>
+#include <atomic>
+#include <chrono>       // steady_clock
+#include <concepts>     // integral, invocable
+#include <cstddef>      // size_t
+#include <cstdint>      // uint64_t, uintptr_t
 #include <functional>
+#include <memory>       // unique_ptr, make_unique_for_overwrite
+#include <source_location>
+#include <thread>
+#include <type_traits>  // common_type_t, make_unsigned_t, is_trivially_copyable_v
+#include <utility>      // move, forward
+#include <vector>
+
+#include "concurrency-support-library/hardware.hpp"
+#include "concurrency-support-library/task-group.hpp"
+#include "concurrency-support-library/thread.hpp"
 
 
 /** Namespace for parallel, async operations */
 namespace conc {
 
+    namespace detail {
+        /** Auto schedule aims at chunks of this duration: cost of taking chunk is below 1% of it. */
+        inline constexpr std::uint64_t kAutoChunkNs{ 20'000 };
+        /** Shorter chunk is not measured precisely by clock, so its grain grows not more than kAutoGrowth times. */
+        inline constexpr std::uint64_t kAutoMinMeasureNs{ 1'000 };
+        inline constexpr std::size_t kAutoGrowth{ 8 };
+        inline constexpr std::size_t kAutoTuningSlots{ 256 };
+
+        /** Tuned grain of one call site of loop with auto schedule. */
+        struct AutoTuning {
+            /** Hash of source location. 0 - free slot. */
+            std::atomic<std::uint64_t> key{ 0 };
+            /** Grain, that the last loop of call site came to. 0 - not tuned yet. */
+            std::atomic<std::size_t> grain{ 0 };
+        };
+
+        /**
+        * Find or add tuning of call site. Lock-free hash table with linear probing: slots are never freed,
+        * so lookup is a few loads after the first call.
+        *
+        * @return		nullptr, if table is full. Then loop is tuned from scratch every time
+        */
+        inline AutoTuning* FindAutoTuning(const std::source_location& location) noexcept {
+            static std::array<AutoTuning, kAutoTuningSlots> table{};
+            std::uint64_t key{ reinterpret_cast<std::uintptr_t>(location.file_name()) * 0x9E3779B97F4A7C15ull };
+            key ^= (static_cast<std::uint64_t>(location.line()) << 16) ^ location.column();
+            if (key == 0) { key = 1; }
+            for (std::size_t i = 0; i < kAutoTuningSlots; ++i) {
+                AutoTuning& slot{ table[(key + i) % kAutoTuningSlots] };
+                std::uint64_t current{ slot.key.load(std::memory_order_acquire) };
+                if (current == 0 && slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                    return &slot;
+                }
+                if (current == key) { return &slot; }
+            }
+            return nullptr;
+        }
+    } // !namespace detail
+
+
+    /** Kind of dividing loop into chunks. Like schedule clause of OpenMP. */
+    enum class ScheduleKind {
+        kStatic,    // equal chunks are given to threads in advance. Minimal overhead, for equal cost of iterations
+        kDynamic,   // chunks of grain size are taken from common counter by free threads
+        kGuided,    // like dynamic, but chunk is proportional to remaining iterations and shrinks to grain
+        kAuto       // like dynamic, but grain is tuned by measured time of chunks and cached per call site
+    };
+
+    /** Policy of dividing loop into chunks. */
+    struct Schedule {
+        ScheduleKind kind{ ScheduleKind::kStatic };
+        /**
+        * Static:  0 - one equal chunk per thread, else chunks of grain are given to threads by round robin.
+        * Dynamic: chunk size. 0 - auto.
+        * Guided:  minimal chunk size. 0 - 1.
+        * Auto:    is not used.
+        */
+        std::size_t grain{ 0 };
+        /** Auto: cache of call site. nullptr - grain is tuned from scratch. */
+        detail::AutoTuning* tuning{ nullptr };
+
+        static constexpr Schedule Static(std::size_t grain = 0) noexcept { return { ScheduleKind::kStatic, grain }; }
+        static constexpr Schedule Dynamic(std::size_t grain = 0) noexcept { return { ScheduleKind::kDynamic, grain }; }
+        static constexpr Schedule Guided(std::size_t min_grain = 1) noexcept { return { ScheduleKind::kGuided, min_grain }; }
+
+        /**
+        * Grain is chosen at runtime. Caller thread measures its chunks and sets grain, so that chunk takes about
+        * kAutoChunkNs, but every thread gets several chunks for balance. The first call of call site begins from
+        * grain 1 and grows it, next calls begin from grain, that the previous call came to.
+        * Call site is location of call of Auto(): for_parallel(pool, Schedule::Auto(), func, 0, n);
+        */
+        static Schedule Auto(std::source_location location = std::source_location::current()) noexcept {
+            return { ScheduleKind::kAuto, 0, detail::FindAutoTuning(location) };
+        }
+    };
+
+
+    namespace detail {
+        /**
+        * Divide range [start, end) into chunks by schedule.
+        * Every participant thread calls Next(), until it returns false.
+        * Dynamic and guided chunks are taken from one atomic counter, so free threads take work of slow threads.
+        * Counter is offset from start, so it doesn't overflow IndexT.
+        */
+        template<std::integral IndexT>
+        class RangeScheduler {
+            /** Difference of signed indices may overflow signed type. Unsigned arithmetic is modular. */
+            using UnsignedIndexT = std::make_unsigned_t<IndexT>;
+        public:
+            RangeScheduler(IndexT start, IndexT end, std::size_t participants_count, Schedule schedule) noexcept
+                : start_{ start },
+                iterations_count_{ end > start ? static_cast<std::size_t>(static_cast<UnsignedIndexT>(end)
+                                                                        - static_cast<UnsignedIndexT>(start)) : 0 },
+                requested_grain_{ schedule.grain },
+                schedule_{ schedule } {
+                set_participants_count(participants_count);
+            }
+
+            /** Is called before the first Next(). */
+            void set_participants_count(std::size_t participants_count) noexcept {
+                participants_count_ = participants_count == 0 ? 1 : participants_count;
+                schedule_.grain = requested_grain_;
+                if (schedule_.kind == ScheduleKind::kAuto) { // several chunks per thread for balance
+                    max_grain_ = std::max<std::size_t>(1, iterations_count_ / (participants_count_ * 4));
+                    const std::size_t cached{ schedule_.tuning ? schedule_.tuning->grain.load(std::memory_order_relaxed) : 0 };
+                    tuned_grain_ = cached == 0 ? 1 : cached;
+                    auto_grain_.store(std::min(tuned_grain_, max_grain_), std::memory_order_relaxed);
+                }
+                if (schedule_.grain == 0) {
+                    if (schedule_.kind == ScheduleKind::kDynamic) { // 8 chunks per thread is enough for balance
+                        schedule_.grain = iterations_count_ / (participants_count_ * 8);
+                    }
+                    if (schedule_.kind != ScheduleKind::kStatic && schedule_.grain == 0) { schedule_.grain = 1; }
+                }
+            }
+
+            std::size_t iterations_count() const noexcept { return iterations_count_; }
+
+            /**
+            * Get next chunk of participant.
+            *
+            * @param participant	index of thread in [0, participants_count)
+            * @param round			counter of chunks of participant. Must be 0 before first call
+            * @param begin			begin of chunk
+            * @param end			end of chunk
+            * @return				false, if there is no more chunks
+            */
+            bool Next(std::size_t participant, std::size_t& round, IndexT& begin, IndexT& end) noexcept {
+                std::size_t first{ 0 };
+                std::size_t last{ 0 };
+                switch (schedule_.kind) {
+                case ScheduleKind::kStatic:
+                    if (!NextStatic(participant, round, first, last)) { return false; }
+                    break;
+                case ScheduleKind::kDynamic:
+                    first = next_.fetch_add(schedule_.grain, std::memory_order_relaxed);
+                    if (first >= iterations_count_) { return false; }
+                    last = std::min(first + schedule_.grain, iterations_count_);
+                    break;
+                case ScheduleKind::kGuided:
+                    if (!NextGuided(first, last)) { return false; }
+                    break;
+                case ScheduleKind::kAuto:
+                    if (!NextAuto(participant, first, last)) { return false; }
+                    break;
+                default:
+                    return false;
+                }
+                ++round;
+                begin = static_cast<IndexT>(static_cast<UnsignedIndexT>(start_) + static_cast<UnsignedIndexT>(first));
+                end = static_cast<IndexT>(static_cast<UnsignedIndexT>(start_) + static_cast<UnsignedIndexT>(last));
+                return true;
+            }
+
+        private:
+            bool NextStatic(std::size_t participant, std::size_t round,
+                            std::size_t& first, std::size_t& last) const noexcept {
+                if (schedule_.grain == 0) { // one chunk. Remainder is spread among first chunks
+                    if (round > 0 || participant >= participants_count_) { return false; }
+                    const std::size_t len{ iterations_count_ / participants_count_ };
+                    const std::size_t remainder{ iterations_count_ % participants_count_ };
+                    first = participant * len + std::min(participant, remainder);
+                    last = first + len + (participant < remainder ? 1 : 0);
+                    return first < last;
+                }
+                const std::size_t chunk{ participant + round * participants_count_ }; // round robin
+                if (chunk >= (iterations_count_ + schedule_.grain - 1) / schedule_.grain) { return false; }
+                first = chunk * schedule_.grain;
+                last = std::min(first + schedule_.grain, iterations_count_);
+                return true;
+            }
+
+            bool NextGuided(std::size_t& first, std::size_t& last) noexcept {
+                std::size_t current{ next_.load(std::memory_order_relaxed) };
+                while (current < iterations_count_) {
+                    const std::size_t remaining{ iterations_count_ - current };
+                    const std::size_t chunk{ std::min(remaining,
+                                        std::max(remaining / (participants_count_ * 2), schedule_.grain)) };
+                    if (next_.compare_exchange_weak(current, current + chunk, std::memory_order_relaxed)) {
+                        first = current;
+                        last = current + chunk;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /**
+            * Dynamic chunk of current grain. Participant 0 (caller thread) measures its previous chunk and
+            * tunes grain for all participants. The last grain is saved for the next call of call site.
+            */
+            bool NextAuto(std::size_t participant, std::size_t& first, std::size_t& last) noexcept {
+                std::uint64_t now{ 0 };
+                if (participant == 0) {
+                    now = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+                    if (probe_size_ != 0) { Tune(probe_size_, now - probe_start_); }
+                }
+                const std::size_t grain{ auto_grain_.load(std::memory_order_relaxed) };
+                first = next_.fetch_add(grain, std::memory_order_relaxed);
+                if (first >= iterations_count_) {
+                    if (participant == 0 && schedule_.tuning) {
+                        schedule_.tuning->grain.store(tuned_grain_, std::memory_order_relaxed);
+                    }
+                    return false;
+                }
+                last = std::min(first + grain, iterations_count_);
+                if (participant == 0) {
+                    probe_start_ = now;
+                    probe_size_ = last - first;
+                }
+                return true;
+            }
+
+            /** Grain, whose chunk takes kAutoChunkNs, if chunk of size iterations took duration. */
+            void Tune(std::size_t size, std::uint64_t duration) noexcept {
+                const double ideal{ static_cast<double>(size) * static_cast<double>(kAutoChunkNs)
+                                    / static_cast<double>(std::max<std::uint64_t>(duration, 1)) };
+                std::size_t grain{ ideal >= static_cast<double>(iterations_count_)
+                                    ? iterations_count_ : static_cast<std::size_t>(ideal) };
+                if (duration < kAutoMinMeasureNs) { grain = std::min(grain, size * kAutoGrowth); }
+                tuned_grain_ = std::max<std::size_t>(1, grain);
+                auto_grain_.store(std::min(tuned_grain_, max_grain_), std::memory_order_relaxed);
+            }
+
+            const IndexT start_;
+            const std::size_t iterations_count_;
+            std::size_t participants_count_{ 1 };
+            const std::size_t requested_grain_;
+            Schedule schedule_;
+            /** Auto: state of participant 0. */
+            std::size_t max_grain_{ 1 };
+            std::size_t tuned_grain_{ 1 };
+            std::uint64_t probe_start_{ 0 };
+            std::size_t probe_size_{ 0 };
+
+            /** Offset of the first not taken iteration. */
+            alignas(kCacheLineSize) std::atomic<std::size_t> next_{ 0 };
+            /** Auto: current grain. Is read with next_, so it is on the same cache line. */
+            std::atomic<std::size_t> auto_grain_{ 1 };
+        };
+
+
+        /** Count of threads for loop: workers of pool, but not more than iterations. */
+        inline std::size_t ParticipantsCount(const util::thread::ThreadPool& pool, std::size_t iterations_count) noexcept {
+            return std::max<std::size_t>(1, std::min(pool.size(), iterations_count));
+        }
+
+        /**
+        * Run participant_func(participant) for every participant in [0, participants_count).
+        * Participant 0 is run by caller thread, that is not pinned, if it is not worker of pool. Participant i is
+        * posted to worker first_worker + i - 1. Wait all and rethrow the first exception.
+        * Caller executes pending tasks while waiting, so nested loops don't block workers.
+        * Participant is sent to the same worker on every call from the same thread, so static schedule touches
+        * the same data from the same CPU (NUMA node).
+        */
+        template<typename ParticipantFuncT>
+        void RunParticipants(util::thread::ThreadPool& pool, std::size_t participants_count,
+                            ParticipantFuncT&& participant_func) {
+            const std::size_t caller_index{ pool.current_worker_index() };
+            const std::size_t first_worker{
+                caller_index == util::thread::ThreadPool::kNotWorker ? 0 : caller_index + 1 };
+            task_group group{ pool };
+            for (std::size_t participant = 1; participant < participants_count; ++participant) {
+                group.run_on(first_worker + participant - 1, [&participant_func, participant]() {
+                    participant_func(participant);
+                });
+            }
+            participant_func(0); // on exception destructor of group waits other participants
+            group.wait(); // Wait all chunks execute
+        }
+    } // !namespace detail
+
+
     /**
     * Parallel multithread realisation of for loop.No Concurrency.No Common resources.
-    * Typical Loop: for (int start_index = 0; start_index < end_index; ++start_index) {}
+    * Typical Loop: for (IndexT start_index = 0; start_index < end_index; ++start_index) {}
+    * Loop is divided into chunks by schedule. Participants are workers of pool and caller thread.
+    * No threads are created. Exception of chunk is rethrown in caller thread.
+    * Caller executes pending tasks of pool while waiting, so loop can be nested in other loop or task.
+    *
+    * Loop func is any callable object, not std::function, so it can be inlined. Index type is common type
+    * of start_index and end_index. 64-bit index works with more than 4G iterations.
+    * For loop func: void(IndexT istart, IndexT imax, ArgsT... args) { for (; istart < imax; ++istart) {} }
+    */
+    template<typename FuncT, std::integral BeginT, std::integral EndT, typename... ArgsT>
+        requires std::invocable<FuncT&, std::common_type_t<BeginT, EndT>, std::common_type_t<BeginT, EndT>, ArgsT&...>
+    void for_parallel(util::thread::ThreadPool& pool, Schedule schedule, FuncT&& for_loop_func,
+                        BeginT start_index, EndT end_index, ArgsT... args) {
+        using IndexT = std::common_type_t<BeginT, EndT>;
+        const IndexT start{ static_cast<IndexT>(start_index) };
+        const IndexT end{ static_cast<IndexT>(end_index) };
+        if (end <= start) { return; }
+
+        detail::RangeScheduler<IndexT> scheduler{ start, end, 1, schedule };
+        const std::size_t participants_count{ detail::ParticipantsCount(pool, scheduler.iterations_count()) };
+        scheduler.set_participants_count(participants_count);
+
+        detail::RunParticipants(pool, participants_count, [&scheduler, &for_loop_func, &args...](std::size_t participant) {
+            std::size_t round{ 0 };
+            IndexT chunk_begin{ 0 };
+            IndexT chunk_end{ 0 };
+            while (scheduler.Next(participant, round, chunk_begin, chunk_end)) {
+                std::invoke(for_loop_func, chunk_begin, chunk_end, args...);
+            }
+        });
+    }
+
+    /** Parallel for loop with static schedule on pool. */
+    template<typename FuncT, std::integral BeginT, std::integral EndT, typename... ArgsT>
+    void for_parallel(util::thread::ThreadPool& pool, FuncT&& for_loop_func,
+                        BeginT start_index, EndT end_index, ArgsT... args) {
+        for_parallel(pool, Schedule::Static(), std::forward<FuncT>(for_loop_func), start_index, end_index, args...);
+    }
+
+    /** Parallel for loop with schedule on DefaultThreadPool(). */
+    template<typename FuncT, std::integral BeginT, std::integral EndT, typename... ArgsT>
+    void for_parallel(Schedule schedule, FuncT&& for_loop_func,
+                        BeginT start_index, EndT end_index, ArgsT... args) {
+        for_parallel(util::thread::DefaultThreadPool(), schedule, std::forward<FuncT>(for_loop_func),
+                    start_index, end_index, args...);
+    }
+
+    /**
+    * Parallel multithread realisation of for loop.No Concurrency.No Common resources.
+    * Typical Loop: for (IndexT start_index = 0; start_index < end_index; ++start_index) {}
+    * Is executed on DefaultThreadPool() with static schedule.
+    * Loop func may be lambda, functor, function or std::function.
     * If need to wrap member function void MemberFunction(int, int) of class A of object obj:
-    * std::function<void(int, int)> func{ std::bind(&A::MemberFunction, &obj, std::placeholders::_1, std::placeholders::_2) };
-    * multithreading::for_parallel(func, 0, max_iteration);
+    * auto func{ [&obj](int i, int imax) { obj.MemberFunction(i, imax); } };
+    * conc::for_parallel(func, 0, max_iteration);
     * For loop func: for (; istart < imax; ++istart) {}
     */
-    template<typename FuncT, typename... ArgsT>
-    void for_parallel(std::function<FuncT> for_loop_func, int start_index, const int end_index, ArgsT... args) {
-        unsigned int max_threads_count{ std::thread::hardware_concurrency() };
-        std::vector<std::thread> running_threads{};
+    template<typename FuncT, std::integral BeginT, std::integral EndT, typename... ArgsT>
+    void for_parallel(FuncT&& for_loop_func, BeginT start_index, EndT end_index, ArgsT... args) {
+        for_parallel(util::thread::DefaultThreadPool(), Schedule::Static(), std::forward<FuncT>(for_loop_func),
+                    start_index, end_index, args...);
+    }
 
-        const int iterations_count{ end_index - start_index };
-        unsigned int loop_len{ iterations_count / max_threads_count };
-        if (iterations_count <= max_threads_count) { // Not all threads will be used
-            loop_len = 1;
-            max_threads_count = iterations_count;
-        }
+    /**
+    * Parallel reduction of range [start_index, end_index).
+    * Every participant thread has own accumulator, padded to cache line, so there is no atomics, mutexes and
+    * false sharing in loop. Accumulators are combined by pairs in tree at the end.
+    * Range is divided by the same schedule, as in for_parallel.
+    *
+    * For static schedule result is deterministic. For others combine must be associative and commutative.
+    *
+    * @param identity		initial value of every accumulator. combine(identity, x) == x
+    * @param body			ValueT(IndexT begin, IndexT end, ValueT accumulator). Reduce chunk into accumulator
+    * @param combine		ValueT(ValueT lhs, ValueT rhs). Combine two accumulators
+    * @return				combined value of all chunks
+    */
+    template<std::integral BeginT, std::integral EndT, typename ValueT, typename BodyT, typename CombineT>
+        requires std::invocable<BodyT&, std::common_type_t<BeginT, EndT>, std::common_type_t<BeginT, EndT>, ValueT>
+                && std::invocable<CombineT&, ValueT, ValueT>
+    ValueT parallel_reduce(util::thread::ThreadPool& pool, Schedule schedule, BeginT start_index, EndT end_index,
+                            const ValueT& identity, BodyT&& body, CombineT&& combine) {
+        using IndexT = std::common_type_t<BeginT, EndT>;
+        const IndexT start{ static_cast<IndexT>(start_index) };
+        const IndexT end{ static_cast<IndexT>(end_index) };
+        if (end <= start) { return identity; }
+
+        detail::RangeScheduler<IndexT> scheduler{ start, end, 1, schedule };
+        const std::size_t participants_count{ detail::ParticipantsCount(pool, scheduler.iterations_count()) };
+        scheduler.set_participants_count(participants_count);
 
-        for (int thr = 0; thr < max_threads_count; ++thr) { // divide big loop into threads
-            if (thr < (max_threads_count - 1)) { // for all threads except the last
-                running_threads.emplace_back(for_loop_func, start_index + thr * loop_len, start_index + (thr + 1) * loop_len, args...);
-            } else { // last thread
-                running_threads.emplace_back(for_loop_func, start_index + thr * loop_len, end_index, args...);
+        std::vector<CacheLinePadded<ValueT>> accumulators(participants_count, CacheLinePadded<ValueT>{ identity });
+        detail::RunParticipants(pool, participants_count, [&scheduler, &body, &accumulators](std::size_t participant) {
+            ValueT accumulator{ std::move(accumulators[participant].value) }; // local copy is in register or stack
+            std::size_t round{ 0 };
+            IndexT chunk_begin{ 0 };
+            IndexT chunk_end{ 0 };
+            while (scheduler.Next(participant, round, chunk_begin, chunk_end)) {
+                accumulator = std::invoke(body, chunk_begin, chunk_end, std::move(accumulator));
             }
-        }
+            accumulators[participant].value = std::move(accumulator);
+        });
 
-        // Wait all threads execute
-        for (int i = 0, imax = running_threads.size(); i < imax; ++i) {
-            running_threads[i].join();
+        for (std::size_t step = 1; step < participants_count; step *= 2) { // tree combine
+            for (std::size_t i = 0; i + step < participants_count; i += 2 * step) {
+                accumulators[i].value = std::invoke(combine, std::move(accumulators[i].value),
+                                                            std::move(accumulators[i + step].value));
+            }
         }
-        //running_threads.clear();
+        return std::move(accumulators[0].value);
+    }
+
+    /** Parallel reduction with static schedule on DefaultThreadPool(). */
+    template<std::integral BeginT, std::integral EndT, typename ValueT, typename BodyT, typename CombineT>
+    ValueT parallel_reduce(BeginT start_index, EndT end_index, const ValueT& identity, BodyT&& body, CombineT&& combine) {
+        return parallel_reduce(util::thread::DefaultThreadPool(), Schedule::Static(), start_index, end_index, identity,
+                                std::forward<BodyT>(body), std::forward<CombineT>(combine));
+    }
+
+    /**
+    * Parallel reduction of transformed indices: reduce(... reduce(identity, transform(start)) ..., transform(end - 1)).
+    *
+    * @param identity		initial value of every accumulator. reduce(identity, x) == x
+    * @param reduce			ValueT(ValueT lhs, ValueT rhs)
+    * @param transform		ValueT(IndexT index)
+    */
+    template<std::integral BeginT, std::integral EndT, typename ValueT, typename ReduceT, typename TransformT>
+    ValueT parallel_transform_reduce(util::thread::ThreadPool& pool, Schedule schedule,
+                                    BeginT start_index, EndT end_index, const ValueT& identity,
+                                    ReduceT&& reduce, TransformT&& transform) {
+        using IndexT = std::common_type_t<BeginT, EndT>;
+        return parallel_reduce(pool, schedule, start_index, end_index, identity,
+            [&reduce, &transform](IndexT i, IndexT imax, ValueT accumulator) {
+                for (; i < imax; ++i) {
+                    accumulator = std::invoke(reduce, std::move(accumulator), std::invoke(transform, i));
+                }
+                return accumulator;
+            },
+            reduce);
+    }
+
+    /** Parallel transform reduction with static schedule on DefaultThreadPool(). */
+    template<std::integral BeginT, std::integral EndT, typename ValueT, typename ReduceT, typename TransformT>
+    ValueT parallel_transform_reduce(BeginT start_index, EndT end_index, const ValueT& identity,
+                                    ReduceT&& reduce, TransformT&& transform) {
+        return parallel_transform_reduce(util::thread::DefaultThreadPool(), Schedule::Static(), start_index, end_index,
+                                        identity, std::forward<ReduceT>(reduce), std::forward<TransformT>(transform));
+    }
+
+    /**
+    * Allocate array, that is filled by workers of pool with static schedule.
+    * OS places memory page on NUMA node of thread, that touches it first. So later for_parallel with
+    * the same pool, range [0, count) and static schedule, called from the same thread, works with local memory.
+    * Makes sense with pool, whose workers are pinned: ThreadPool(threads, WorkerAffinity::kNumaNodes).
+    * The first chunk is touched by calling thread (participant 0), so call it from worker of pool or from
+    * thread, that is pinned like the first worker.
+    */
+    template<typename T>
+        requires std::is_trivially_default_constructible_v<T> && std::is_trivially_copyable_v<T>
+    std::unique_ptr<T[]> make_first_touch_array(util::thread::ThreadPool& pool, std::size_t count, const T& value) {
+        std::unique_ptr<T[]> array{ std::make_unique_for_overwrite<T[]>(count) }; // pages are not touched
+        for_parallel(pool, Schedule::Static(), [data = array.get(), &value](std::size_t i, std::size_t imax) {
+            for (; i < imax; ++i) { data[i] = value; }
+        }, std::size_t{ 0 }, count);
+        return array;
     }
 
     /**
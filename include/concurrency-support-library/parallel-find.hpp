@@ -0,0 +1,105 @@
+﻿#ifndef PARALLEL_FIND_HPP
+#define PARALLEL_FIND_HPP
+
+#include <algorithm>	// find_if, max
+#include <atomic>
+#include <cstddef>		// size_t, ptrdiff_t
+#include <functional>	// invoke
+#include <iterator>		// random_access_iterator
+#include <stop_token>	// stop_token
+#include <utility>		// move
+
+#include "concurrency-support-library/hardware.hpp"
+#include "concurrency-support-library/multithreading.hpp"
+#include "concurrency-support-library/thread.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	namespace detail {
+		/** Less elements are searched by caller thread. */
+		inline constexpr std::size_t kFindMinChunkSize{ 4 * 1024 };
+	} // !namespace detail
+
+
+	/**
+	* Parallel search of the first element, that satisfies predicate. Result is the same, as of std::find_if.
+	* Chunks are taken in ascending order from common counter. Participants share the lowest found index:
+	* chunks and elements after it are skipped, so search stops soon after match, and all elements before
+	* match are checked, so it is the first one.
+	* Search is stopped, when stop is requested for token. Then result is last.
+	*
+	* Complexity: O(index of match / threads + chunk).
+	*
+	* @return		iterator to the first element, that satisfies predicate, or last
+	*/
+	template<std::random_access_iterator ItT, typename PredicateT>
+	ItT parallel_find_if(util::thread::ThreadPool& pool, ItT first, ItT last, PredicateT predicate,
+						std::stop_token token = {}) {
+		const std::size_t size{ static_cast<std::size_t>(last - first) };
+		const std::size_t participants_count{ detail::ParticipantsCount(pool, size / detail::kFindMinChunkSize) };
+		if (participants_count <= 1 && !token.stop_possible()) { return std::find_if(first, last, predicate); }
+
+		// Small chunks: match is found soon, if it is close to the beginning
+		const std::size_t grain{ std::max(detail::kFindMinChunkSize, size / (participants_count * 64)) };
+		detail::RangeScheduler<std::size_t> scheduler{ 0, size, participants_count, Schedule::Dynamic(grain) };
+		alignas(kCacheLineSize) std::atomic<std::size_t> found{ size };
+
+		detail::RunParticipants(pool, participants_count,
+								[&scheduler, &found, &token, &predicate, first](std::size_t participant) {
+			std::size_t round{ 0 };
+			std::size_t chunk_begin{ 0 };
+			std::size_t chunk_end{ 0 };
+			while (scheduler.Next(participant, round, chunk_begin, chunk_end)) {
+				if (chunk_begin >= found.load(std::memory_order_relaxed) || token.stop_requested()) { return; }
+				for (std::size_t i = chunk_begin; i < chunk_end; ++i) {
+					if (std::invoke(predicate, first[static_cast<std::ptrdiff_t>(i)])) {
+						std::size_t current{ found.load(std::memory_order_relaxed) };
+						while (i < current && !found.compare_exchange_weak(current, i, std::memory_order_relaxed)) {}
+						return; // next chunks have greater indices
+					}
+					if (i >= found.load(std::memory_order_relaxed)) { return; } // other participant found earlier
+				}
+			}
+		});
+		if (token.stop_requested()) { return last; }
+		return first + static_cast<std::ptrdiff_t>(found.load(std::memory_order_relaxed));
+	}
+
+	/** Parallel search of the first element, that is equal to value. */
+	template<std::random_access_iterator ItT, typename ValueT>
+	ItT parallel_find(util::thread::ThreadPool& pool, ItT first, ItT last, const ValueT& value,
+					std::stop_token token = {}) {
+		return parallel_find_if(pool, first, last, [&value](const auto& element) { return element == value; },
+								std::move(token));
+	}
+
+	/** Parallel search on DefaultThreadPool(). */
+	template<std::random_access_iterator ItT, typename PredicateT>
+	ItT parallel_find_if(ItT first, ItT last, PredicateT predicate, std::stop_token token = {}) {
+		return parallel_find_if(util::thread::DefaultThreadPool(), first, last, std::move(predicate), std::move(token));
+	}
+
+	/** Parallel search of value on DefaultThreadPool(). */
+	template<std::random_access_iterator ItT, typename ValueT>
+	ItT parallel_find(ItT first, ItT last, const ValueT& value, std::stop_token token = {}) {
+		return parallel_find(util::thread::DefaultThreadPool(), first, last, value, std::move(token));
+	}
+
+	/** Parallel check, that any element satisfies predicate. Stops soon after the first match. */
+	template<std::random_access_iterator ItT, typename PredicateT>
+	bool parallel_any_of(util::thread::ThreadPool& pool, ItT first, ItT last, PredicateT predicate,
+						std::stop_token token = {}) {
+		return parallel_find_if(pool, first, last, std::move(predicate), std::move(token)) != last;
+	}
+
+	/** Parallel any_of on DefaultThreadPool(). */
+	template<std::random_access_iterator ItT, typename PredicateT>
+	bool parallel_any_of(ItT first, ItT last, PredicateT predicate, std::stop_token token = {}) {
+		return parallel_any_of(util::thread::DefaultThreadPool(), first, last, std::move(predicate), std::move(token));
+	}
+
+} // !namespace conc
+
+#endif // !PARALLEL_FIND_HPP
@@ -0,0 +1,216 @@
+﻿#ifndef PARALLEL_REGION_HPP
+#define PARALLEL_REGION_HPP
+
+#include <algorithm>	// find
+#include <atomic>
+#include <barrier>
+#include <concepts>		// integral, invocable
+#include <cstddef>		// size_t, ptrdiff_t
+#include <exception>	// exception_ptr
+#include <functional>	// invoke
+#include <mutex>		// mutex, lock_guard
+#include <thread>		// this_thread::yield
+#include <type_traits>	// common_type_t
+#include <utility>		// forward, exchange
+#include <vector>
+
+#include "concurrency-support-library/multithreading.hpp"
+#include "concurrency-support-library/thread.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	namespace detail {
+		/** Is thrown from barrier of region, after other participant failed. */
+		struct RegionCancelled {};
+
+		/**
+		* Pools, that run region now. Participants of region block workers until it ends, so two regions on the
+		* same pool could take half of workers each and wait for the rest forever. Regions of one pool are run
+		* one after another.
+		*/
+		class RegionGate {
+		public:
+			/** Wait the end of region of pool. Waiting thread executes pending tasks of pool meanwhile. */
+			explicit RegionGate(util::thread::ThreadPool& pool) : pool_{ pool } {
+				while (!TryEnter()) {
+					if (!pool_.try_run_pending_task()) { std::this_thread::yield(); }
+				}
+			}
+
+			RegionGate(const RegionGate&) = delete;
+			RegionGate& operator=(const RegionGate&) = delete;
+			RegionGate(RegionGate&&) noexcept = delete;
+			RegionGate& operator=(RegionGate&&) noexcept = delete;
+
+			~RegionGate() {
+				Pools& pools{ GetPools() };
+				std::lock_guard<std::mutex> lock{ pools.mutex_ };
+				std::erase(pools.busy_, &pool_);
+			}
+
+		private:
+			struct Pools {
+				std::mutex mutex_{};
+				std::vector<const util::thread::ThreadPool*> busy_{};
+			};
+
+			static Pools& GetPools() {
+				static Pools pools{};
+				return pools;
+			}
+
+			bool TryEnter() {
+				Pools& pools{ GetPools() };
+				std::lock_guard<std::mutex> lock{ pools.mutex_ };
+				if (std::find(pools.busy_.begin(), pools.busy_.end(), &pool_) != pools.busy_.end()) { return false; }
+				pools.busy_.push_back(&pool_);
+				return true;
+			}
+
+			util::thread::ThreadPool& pool_;
+		}; // !class RegionGate
+	} // !namespace detail
+
+
+	/**
+	* Team of participants of parallel_region(). Every participant executes the same body with own region.
+	* Iteration of work-sharing is only static division of range and std::barrier, so it costs much less,
+	* than for_parallel, that submits tasks and waits them on every call.
+	*
+	* Every participant must call barrier(), for_parallel() and single() in the same order and the same
+	* number of times, like in OpenMP parallel region.
+	*/
+	class region {
+	public:
+		explicit region(std::size_t participants_count) noexcept
+			: participants_count_{ participants_count }, barrier_{ static_cast<std::ptrdiff_t>(participants_count) } {
+		}
+
+		region(const region&) = delete;
+		region& operator=(const region&) = delete;
+		region(region&&) noexcept = delete;
+		region& operator=(region&&) noexcept = delete;
+
+		~region() = default;
+
+		/** Index of current participant in [0, participants_count). 0 - thread, that called parallel_region(). */
+		std::size_t participant() const noexcept { return CurrentParticipant(); }
+
+		std::size_t participants_count() const noexcept { return participants_count_; }
+
+		/** Wait all participants. */
+		void barrier() {
+			barrier_.arrive_and_wait();
+			if (cancelled_.load(std::memory_order_acquire)) { throw detail::RegionCancelled{}; }
+		}
+
+		/**
+		* Execute static chunk of participant of range [start_index, end_index), then wait all participants.
+		* Chunks are the same on every iteration, so every participant works with the same data in cache.
+		* For loop func: void(IndexT istart, IndexT imax) { for (; istart < imax; ++istart) {} }
+		*/
+		template<typename FuncT, std::integral BeginT, std::integral EndT>
+			requires std::invocable<FuncT&, std::common_type_t<BeginT, EndT>, std::common_type_t<BeginT, EndT>>
+		void for_parallel(FuncT&& for_loop_func, BeginT start_index, EndT end_index) {
+			using IndexT = std::common_type_t<BeginT, EndT>;
+			const IndexT start{ static_cast<IndexT>(start_index) };
+			const IndexT end{ static_cast<IndexT>(end_index) };
+			if (start < end) {
+				detail::RangeScheduler<IndexT> scheduler{ start, end, participants_count_, Schedule::Static() };
+				std::size_t round{ 0 };
+				IndexT chunk_begin{ 0 };
+				IndexT chunk_end{ 0 };
+				if (scheduler.Next(participant(), round, chunk_begin, chunk_end)) {
+					std::invoke(for_loop_func, chunk_begin, chunk_end);
+				}
+			}
+			barrier();
+		}
+
+		/** Execute func by participant 0, then wait all participants. Result is visible to all of them. */
+		template<typename FuncT>
+		void single(FuncT&& func) {
+			if (participant() == 0) { std::invoke(std::forward<FuncT>(func)); }
+			barrier();
+		}
+
+	private:
+		template<typename BodyT>
+		friend void parallel_region(util::thread::ThreadPool& pool, BodyT&& body);
+
+		/** Participant of the innermost region of current thread. */
+		static std::size_t& CurrentParticipant() noexcept {
+			thread_local std::size_t participant{ 0 };
+			return participant;
+		}
+
+		template<typename BodyT>
+		void RunParticipant(std::size_t participant, BodyT& body) {
+			std::size_t& current{ CurrentParticipant() };
+			const std::size_t outer{ std::exchange(current, participant) };
+			try {
+				std::invoke(body, *this);
+			} catch (const detail::RegionCancelled&) {
+			} catch (...) {
+				Fail(std::current_exception());
+			}
+			current = outer;
+			barrier_.arrive_and_drop(); // others don't wait finished participant
+		}
+
+		void Fail(std::exception_ptr exception) noexcept {
+			{
+				std::lock_guard<std::mutex> lock{ exception_mutex_ };
+				if (!exception_) { exception_ = exception; }
+			}
+			cancelled_.store(true, std::memory_order_release);
+		}
+
+		const std::size_t participants_count_;
+		std::barrier<> barrier_;
+		std::atomic<bool> cancelled_{ false };
+		std::mutex exception_mutex_{};
+		std::exception_ptr exception_{};
+	}; // !class region
+
+	/**
+	* Parallel region: body(region&) is executed once by caller thread and by workers of pool, that stay in
+	* region until body returns. Loops inside body are shared by region.for_parallel(), that only waits barrier,
+	* so iterative solvers don't submit tasks on every iteration of outer loop.
+	*
+	* Workers are busy during the whole region. Region must not wait for other tasks of pool, and regions
+	* must not be nested: participants block in barrier and don't execute other tasks.
+	* Only one region runs on pool at a time: parallel_region() from other thread waits the end of current one
+	* and executes pending tasks of pool meanwhile.
+	* Exception of participant cancels region: other participants leave it at the next barrier. The first
+	* exception is rethrown.
+	*
+	* Example:
+	* conc::parallel_region(pool, [&](conc::region& region) {
+	*	for (int iteration = 0; !converged; ++iteration) {
+	*		region.for_parallel([&](int i, int imax) { Relax(i, imax); }, 0, n);
+	*		region.single([&]() { converged = Residual() < epsilon; });
+	*	}
+	* });
+	*/
+	template<typename BodyT>
+	void parallel_region(util::thread::ThreadPool& pool, BodyT&& body) {
+		const detail::RegionGate gate{ pool };
+		region team{ detail::ParticipantsCount(pool, pool.size()) };
+		detail::RunParticipants(pool, team.participants_count(), [&team, &body](std::size_t participant) {
+			team.RunParticipant(participant, body);
+		});
+		if (team.exception_) { std::rethrow_exception(team.exception_); }
+	}
+
+	/** Parallel region on DefaultThreadPool(). */
+	template<typename BodyT>
+	void parallel_region(BodyT&& body) {
+		parallel_region(util::thread::DefaultThreadPool(), std::forward<BodyT>(body));
+	}
+
+} // !namespace conc
+
+#endif // !PARALLEL_REGION_HPP
@@ -0,0 +1,149 @@
+﻿#ifndef PARALLEL_SCAN_HPP
+#define PARALLEL_SCAN_HPP
+
+#include <algorithm>	// min
+#include <cstddef>		// size_t
+#include <functional>	// plus, invoke
+#include <iterator>		// iterator_traits, random_access_iterator
+#include <numeric>		// inclusive_scan, exclusive_scan
+#include <utility>		// move
+#include <vector>
+
+#include "concurrency-support-library/hardware.hpp"
+#include "concurrency-support-library/multithreading.hpp"
+#include "concurrency-support-library/thread.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	namespace detail {
+		/** Less elements in block are not worth of parallel scan. Scan is limited by memory bandwidth. */
+		inline constexpr std::size_t kScanMinBlockSize{ 16 * 1024 };
+
+		/**
+		* Two pass blocked scan. Range is divided into equal blocks, one block per participant.
+		* Pass 1: every participant reduces own block.
+		* Caller makes exclusive scan of block sums - offset of every block.
+		* Pass 2: every participant scans own block, starting from block offset.
+		* Every element is read twice and written once. Works in place (d_first == first).
+		*
+		* @param init			nullptr for inclusive scan without initial value
+		*/
+		template<typename InputItT, typename OutputItT, typename ValueT, typename BinaryOpT>
+		OutputItT ParallelScan(util::thread::ThreadPool& pool, InputItT first, InputItT last, OutputItT d_first,
+								BinaryOpT op, const ValueT* init, bool inclusive) {
+			const std::size_t size{ static_cast<std::size_t>(last - first) };
+			if (size == 0) { return d_first; }
+
+			const std::size_t blocks_count{ std::min(ParticipantsCount(pool, size),
+													std::max<std::size_t>(1, size / kScanMinBlockSize)) };
+			auto block_begin = [size, blocks_count](std::size_t block) noexcept {
+				return static_cast<std::ptrdiff_t>(size / blocks_count * block + std::min(block, size % blocks_count));
+			};
+
+			if (blocks_count == 1) { // sequential
+				if (inclusive) {
+					return init ? std::inclusive_scan(first, last, d_first, op, *init)
+								: std::inclusive_scan(first, last, d_first, op);
+				}
+				return std::exclusive_scan(first, last, d_first, *init, op);
+			}
+
+			// Pass 1. Sums of all blocks except last, last sum is not needed
+			std::vector<CacheLinePadded<ValueT>> block_sums(blocks_count);
+			RunParticipants(pool, blocks_count - 1, [&](std::size_t block) {
+				InputItT it{ first + block_begin(block) };
+				const InputItT block_last{ first + block_begin(block + 1) };
+				ValueT sum{ *it };
+				for (++it; it != block_last; ++it) { sum = std::invoke(op, std::move(sum), *it); }
+				block_sums[block].value = std::move(sum);
+			});
+
+			// Offsets of blocks: offsets[i] = init op sum[0] op ... op sum[i - 1]
+			std::vector<CacheLinePadded<ValueT>> offsets(blocks_count);
+			for (std::size_t block = 1; block < blocks_count; ++block) {
+				if (block == 1) {
+					offsets[1].value = init ? std::invoke(op, *init, block_sums[0].value) : block_sums[0].value;
+				} else {
+					offsets[block].value = std::invoke(op, offsets[block - 1].value, block_sums[block - 1].value);
+				}
+			}
+
+			// Pass 2
+			RunParticipants(pool, blocks_count, [&](std::size_t block) {
+				const InputItT block_first{ first + block_begin(block) };
+				const InputItT block_last{ first + block_begin(block + 1) };
+				const OutputItT block_d_first{ d_first + block_begin(block) };
+				const ValueT* offset{ block > 0 ? &offsets[block].value : init };
+				if (!inclusive) {
+					std::exclusive_scan(block_first, block_last, block_d_first, *offset, op);
+				} else if (offset) {
+					std::inclusive_scan(block_first, block_last, block_d_first, op, *offset);
+				} else { // the first block without init
+					std::inclusive_scan(block_first, block_last, block_d_first, op);
+				}
+			});
+			return d_first + static_cast<std::ptrdiff_t>(size);
+		}
+	} // !namespace detail
+
+
+	/**
+	* Parallel inclusive scan of random access range. d_first[i] = first[0] op first[1] op ... op first[i].
+	* Result is equal to std::inclusive_scan. op must be associative.
+	* Small ranges are scanned by caller thread.
+	*
+	* Complexity: O(n / threads). 2 reads and 1 write of every element.
+	*
+	* @return		iterator past the last written element
+	*/
+	template<std::random_access_iterator InputItT, std::random_access_iterator OutputItT,
+			typename BinaryOpT = std::plus<>>
+	OutputItT parallel_inclusive_scan(util::thread::ThreadPool& pool, InputItT first, InputItT last,
+										OutputItT d_first, BinaryOpT op = {}) {
+		using ValueT = typename std::iterator_traits<InputItT>::value_type;
+		return detail::ParallelScan<InputItT, OutputItT, ValueT>(pool, first, last, d_first, op, nullptr, true);
+	}
+
+	/** Parallel inclusive scan with initial value: d_first[i] = init op first[0] op ... op first[i]. */
+	template<std::random_access_iterator InputItT, std::random_access_iterator OutputItT,
+			typename BinaryOpT, typename ValueT>
+	OutputItT parallel_inclusive_scan(util::thread::ThreadPool& pool, InputItT first, InputItT last,
+										OutputItT d_first, BinaryOpT op, ValueT init) {
+		return detail::ParallelScan(pool, first, last, d_first, op, &init, true);
+	}
+
+	/** Parallel inclusive scan on DefaultThreadPool(). */
+	template<std::random_access_iterator InputItT, std::random_access_iterator OutputItT,
+			typename BinaryOpT = std::plus<>>
+	OutputItT parallel_inclusive_scan(InputItT first, InputItT last, OutputItT d_first, BinaryOpT op = {}) {
+		return parallel_inclusive_scan(util::thread::DefaultThreadPool(), first, last, d_first, op);
+	}
+
+	/**
+	* Parallel exclusive scan of random access range. d_first[i] = init op first[0] op ... op first[i - 1].
+	* Result is equal to std::exclusive_scan. op must be associative.
+	*
+	* Complexity: O(n / threads). 2 reads and 1 write of every element.
+	*
+	* @return		iterator past the last written element
+	*/
+	template<std::random_access_iterator InputItT, std::random_access_iterator OutputItT,
+			typename ValueT, typename BinaryOpT = std::plus<>>
+	OutputItT parallel_exclusive_scan(util::thread::ThreadPool& pool, InputItT first, InputItT last,
+										OutputItT d_first, ValueT init, BinaryOpT op = {}) {
+		return detail::ParallelScan(pool, first, last, d_first, op, &init, false);
+	}
+
+	/** Parallel exclusive scan on DefaultThreadPool(). */
+	template<std::random_access_iterator InputItT, std::random_access_iterator OutputItT,
+			typename ValueT, typename BinaryOpT = std::plus<>>
+	OutputItT parallel_exclusive_scan(InputItT first, InputItT last, OutputItT d_first,
+										ValueT init, BinaryOpT op = {}) {
+		return parallel_exclusive_scan(util::thread::DefaultThreadPool(), first, last, d_first, init, op);
+	}
+
+} // !namespace conc
+
+#endif // !PARALLEL_SCAN_HPP
@@ -0,0 +1,124 @@
+﻿#ifndef PARALLEL_SORT_HPP
+#define PARALLEL_SORT_HPP
+
+#include <algorithm>	// sort, merge, lower_bound, upper_bound, max
+#include <cstddef>		// size_t, ptrdiff_t
+#include <functional>	// less
+#include <iterator>		// iterator_traits, random_access_iterator, make_move_iterator
+#include <utility>		// move
+#include <vector>
+
+#include "concurrency-support-library/multithreading.hpp"
+#include "concurrency-support-library/task-group.hpp"
+#include "concurrency-support-library/thread.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	namespace detail {
+		/** Less elements are sorted or merged by one thread: task costs more, than parallel work gives. */
+		inline constexpr std::size_t kSortMinBlockSize{ 8 * 1024 };
+
+		/**
+		* Merge sorted [first1, last1) and [first2, last2) into d_first by moving elements.
+		* The larger range is split by its middle element, the other range by binary search of it, and two halves
+		* are merged in parallel. Equal elements of the first range stay before elements of the second range.
+		*/
+		template<typename ItT, typename OutputItT, typename CompareT>
+		void ParallelMerge(util::thread::ThreadPool& pool, ItT first1, ItT last1, ItT first2, ItT last2,
+							OutputItT d_first, CompareT& comp, std::size_t grain) {
+			const std::size_t size1{ static_cast<std::size_t>(last1 - first1) };
+			const std::size_t size2{ static_cast<std::size_t>(last2 - first2) };
+			if (size1 + size2 <= grain) {
+				std::merge(std::make_move_iterator(first1), std::make_move_iterator(last1),
+							std::make_move_iterator(first2), std::make_move_iterator(last2), d_first, comp);
+				return;
+			}
+
+			ItT middle1{};
+			ItT middle2{};
+			if (size1 >= size2) {
+				middle1 = first1 + static_cast<std::ptrdiff_t>(size1 / 2);
+				middle2 = std::lower_bound(first2, last2, *middle1, comp);
+			} else {
+				middle2 = first2 + static_cast<std::ptrdiff_t>(size2 / 2);
+				middle1 = std::upper_bound(first1, last1, *middle2, comp);
+			}
+			const OutputItT d_middle{ d_first + (middle1 - first1) + (middle2 - first2) };
+
+			task_group group{ pool };
+			group.run([&pool, first1, middle1, first2, middle2, d_first, &comp, grain]() {
+				ParallelMerge(pool, first1, middle1, first2, middle2, d_first, comp, grain);
+			});
+			ParallelMerge(pool, middle1, last1, middle2, last2, d_middle, comp, grain);
+			group.wait();
+		}
+
+		/**
+		* Merge sort of [first, first + size). Halves are sorted in parallel, then merged in parallel.
+		* Levels of recursion swap data and buffer, so every level moves elements once.
+		*
+		* @param to_buffer		result must be in [buffer, buffer + size), else in [first, first + size)
+		*/
+		template<typename ItT, typename BufferItT, typename CompareT>
+		void ParallelMergeSort(util::thread::ThreadPool& pool, ItT first, BufferItT buffer, std::size_t size,
+								CompareT& comp, std::size_t grain, bool to_buffer) {
+			if (size <= grain) {
+				std::sort(first, first + static_cast<std::ptrdiff_t>(size), comp);
+				if (to_buffer) { std::move(first, first + static_cast<std::ptrdiff_t>(size), buffer); }
+				return;
+			}
+
+			const std::size_t half{ size / 2 };
+			const std::ptrdiff_t middle{ static_cast<std::ptrdiff_t>(half) };
+			const std::ptrdiff_t end{ static_cast<std::ptrdiff_t>(size) };
+			task_group group{ pool };
+			group.run([&pool, first, buffer, half, &comp, grain, to_buffer]() {
+				ParallelMergeSort(pool, first, buffer, half, comp, grain, !to_buffer);
+			});
+			ParallelMergeSort(pool, first + middle, buffer + middle, size - half, comp, grain, !to_buffer);
+			group.wait();
+
+			if (to_buffer) { // sorted halves are in place
+				ParallelMerge(pool, first, first + middle, first + middle, first + end, buffer, comp, grain);
+			} else {
+				ParallelMerge(pool, buffer, buffer + middle, buffer + middle, buffer + end, first, comp, grain);
+			}
+		}
+	} // !namespace detail
+
+
+	/**
+	* Parallel merge sort of random access range on pool. Is not stable, like std::sort.
+	* Blocks are sorted by std::sort, then merged by parallel merge, so all levels of merge are parallel.
+	* Small ranges and pool of one thread are sorted by std::sort in caller thread.
+	* Exception of comparator or move is rethrown, range is left in unspecified order.
+	*
+	* Complexity: O(n log n / threads + n log n / grain). Buffer of n elements.
+	*/
+	template<std::random_access_iterator ItT, typename CompareT = std::less<>>
+	void parallel_sort(util::thread::ThreadPool& pool, ItT first, ItT last, CompareT comp = {}) {
+		using ValueT = typename std::iterator_traits<ItT>::value_type;
+		const std::size_t size{ static_cast<std::size_t>(last - first) };
+		const std::size_t participants_count{ detail::ParticipantsCount(pool, size / detail::kSortMinBlockSize) };
+		if (participants_count <= 1) {
+			std::sort(first, last, comp);
+			return;
+		}
+
+		// 8 blocks per thread is enough for balance, when blocks have different cost
+		const std::size_t grain{ std::max(detail::kSortMinBlockSize, size / (participants_count * 8)) };
+		std::vector<ValueT> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+		detail::ParallelMergeSort(pool, buffer.begin(), first, size, comp, grain, true);
+	}
+
+	/** Parallel sort on DefaultThreadPool(). */
+	template<std::random_access_iterator ItT, typename CompareT = std::less<>>
+	void parallel_sort(ItT first, ItT last, CompareT comp = {}) {
+		parallel_sort(util::thread::DefaultThreadPool(), first, last, comp);
+	}
+
+} // !namespace conc
+
+#endif // !PARALLEL_SORT_HPP
@@ -0,0 +1,136 @@
+﻿#ifndef SLOT_ALLOCATOR_HPP
+#define SLOT_ALLOCATOR_HPP
+
+#include <algorithm>	// max
+#include <cstddef>		// size_t
+#include <mutex>		// mutex, lock_guard
+#include <vector>
+
+#include "concurrency-support-library/hardware.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/**
+	* Allocator of memory blocks of one size for objects, that are created by one thread and destroyed by other
+	* (tasks of pool). Allocation and deallocation take block from list of current thread without locks.
+	* Lists are exchanged with global storage by batches of kBatchSize blocks under mutex, so lock is taken
+	* once per kBatchSize operations, and blocks, that were freed by consumer threads, return to producers.
+	*
+	* Blocks are aligned to cache line. Memory is never returned to system: it is reused by next tasks.
+	*/
+	template<std::size_t kSlotSize>
+	class SlotAllocator {
+		static_assert(kSlotSize >= sizeof(void*) && kSlotSize % kCacheLineSize == 0,
+						"slot must hold pointer and be multiple of cache line");
+
+	public:
+		static constexpr std::size_t kBatchSize{ 64 };
+
+		static void* Allocate() {
+			LocalCache& cache{ Cache() };
+			if (!cache.head_) { cache.Refill(); }
+			Slot* slot{ cache.head_ };
+			cache.head_ = slot->next_;
+			--cache.count_;
+			return slot;
+		}
+
+		static void Deallocate(void* pointer) noexcept {
+			LocalCache& cache{ Cache() };
+			Slot* slot{ static_cast<Slot*>(pointer) };
+			slot->next_ = cache.head_;
+			cache.head_ = slot;
+			if (++cache.count_ >= 2 * kBatchSize) { cache.ReturnBatch(kBatchSize); } // consumer gives back
+		}
+
+	private:
+		struct Slot {
+			Slot* next_;
+		};
+
+		struct alignas(kCacheLineSize) SlotStorage {
+			unsigned char bytes_[kSlotSize];
+		};
+
+		struct Batch {
+			Slot* head_;
+			std::size_t count_;
+		};
+
+		/** Free batches of all threads. Is never destroyed: threads may exit after static destructors. */
+		struct Global {
+			std::mutex mutex_{};
+			std::vector<Batch> batches_{};
+			std::vector<SlotStorage*> chunks_{}; // keeps memory reachable
+		};
+
+		struct LocalCache {
+			LocalCache() = default;
+			LocalCache(const LocalCache&) = delete;
+			LocalCache& operator=(const LocalCache&) = delete;
+			LocalCache(LocalCache&&) noexcept = delete;
+			LocalCache& operator=(LocalCache&&) noexcept = delete;
+
+			~LocalCache() { ReturnBatch(count_); } // exiting thread gives back all blocks
+
+			/** Take free batch or allocate new chunk. */
+			void Refill() {
+				Global& global{ GetGlobal() };
+				std::lock_guard<std::mutex> lock{ global.mutex_ };
+				if (!global.batches_.empty()) {
+					const Batch batch{ global.batches_.back() };
+					global.batches_.pop_back();
+					head_ = batch.head_;
+					count_ = batch.count_;
+					return;
+				}
+				if (global.chunks_.size() == global.chunks_.capacity()) { // push_back after new must not throw
+					global.chunks_.reserve(std::max<std::size_t>(16, 2 * global.chunks_.capacity()));
+				}
+				SlotStorage* chunk{ new SlotStorage[kBatchSize] };
+				global.chunks_.push_back(chunk);
+				for (std::size_t i = 0; i < kBatchSize; ++i) {
+					Slot* slot{ reinterpret_cast<Slot*>(&chunk[i]) };
+					slot->next_ = head_;
+					head_ = slot;
+				}
+				count_ = kBatchSize;
+			}
+
+			void ReturnBatch(std::size_t count) noexcept {
+				if (count == 0) { return; }
+				Slot* first{ head_ };
+				Slot* last{ head_ };
+				for (std::size_t i = 1; i < count; ++i) { last = last->next_; }
+				head_ = last->next_;
+				count_ -= count;
+				last->next_ = nullptr;
+
+				Global& global{ GetGlobal() };
+				std::lock_guard<std::mutex> lock{ global.mutex_ };
+				try {
+					global.batches_.push_back(Batch{ first, count });
+				} catch (...) { // no memory for vector: blocks stay unused
+				}
+			}
+
+			Slot* head_{ nullptr };
+			std::size_t count_{ 0 };
+		};
+
+		static Global& GetGlobal() {
+			static Global* global{ new Global{} };
+			return *global;
+		}
+
+		static LocalCache& Cache() noexcept {
+			thread_local LocalCache cache{};
+			return cache;
+		}
+	}; // !class SlotAllocator
+
+} // !namespace conc
+
+#endif // !SLOT_ALLOCATOR_HPP
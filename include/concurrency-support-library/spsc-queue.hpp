@@ -0,0 +1,165 @@
+﻿#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <algorithm>	// copy_n, min, max
+#include <atomic>
+#include <bit>			// bit_ceil
+#include <concepts>		// default_initializable, movable
+#include <cstddef>		// size_t, ptrdiff_t
+#include <iterator>		// make_move_iterator
+#include <memory>		// unique_ptr
+#include <optional>
+#include <span>
+#include <utility>		// forward, move
+
+#include "concurrency-support-library/hardware.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/**
+	* Wait-free single-producer single-consumer ring buffer.
+	* Exactly one thread pushes and exactly one thread pops at the same time.
+	*
+	* Producer owns tail, consumer owns head, they lie on different cache lines. Every side keeps cached copy of
+	* index of other side and reloads it only, when queue looks full (empty), so in steady state the sides
+	* don't touch cache lines of each other. Batch operations publish many values by one store.
+	*
+	* @param T		default constructible and movable. Cells are constructed once, values are assigned
+	*/
+	template<typename T>
+		requires std::default_initializable<T> && std::movable<T>
+	class SpscQueue {
+	public:
+		/** @param capacity		is rounded up to power of two */
+		explicit SpscQueue(std::size_t capacity)
+			: mask_{ std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1 },
+			  buffer_{ std::make_unique<T[]>(mask_ + 1) } {
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+		SpscQueue(SpscQueue&&) noexcept = delete;
+		SpscQueue& operator=(SpscQueue&&) noexcept = delete;
+
+		~SpscQueue() = default;
+
+		/**
+		* Only producer thread.
+		*
+		* @return		false, if queue is full. Value is not changed then
+		*/
+		template<typename ValueT>
+			requires std::assignable_from<T&, ValueT&&>
+		bool try_push(ValueT&& value) {
+			const std::size_t tail{ producer_.tail_.load(std::memory_order_relaxed) };
+			if (FreeCount(tail, 1) == 0) { return false; }
+			buffer_[tail & mask_] = std::forward<ValueT>(value);
+			producer_.tail_.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		* Only producer thread. Push as many values from the beginning of span, as there is free space.
+		*
+		* @return		count of pushed values
+		*/
+		std::size_t push_batch(std::span<const T> values) {
+			const std::size_t tail{ producer_.tail_.load(std::memory_order_relaxed) };
+			const std::size_t count{ std::min(values.size(), FreeCount(tail, values.size())) };
+			if (count == 0) { return 0; }
+
+			const std::size_t index{ tail & mask_ };
+			const std::size_t first_part{ std::min(count, mask_ + 1 - index) }; // before the end of ring
+			std::copy_n(values.begin(), first_part, buffer_.get() + index);
+			std::copy_n(values.begin() + static_cast<std::ptrdiff_t>(first_part), count - first_part, buffer_.get());
+			producer_.tail_.store(tail + count, std::memory_order_release);
+			return count;
+		}
+
+		/**
+		* Only consumer thread.
+		*
+		* @return		the oldest value or nullopt, if queue is empty
+		*/
+		std::optional<T> try_pop() {
+			const std::size_t head{ consumer_.head_.load(std::memory_order_relaxed) };
+			if (ReadyCount(head, 1) == 0) { return std::nullopt; }
+			std::optional<T> result{ std::move(buffer_[head & mask_]) };
+			consumer_.head_.store(head + 1, std::memory_order_release);
+			return result;
+		}
+
+		/**
+		* Only consumer thread. Move the oldest values to the beginning of span.
+		*
+		* @return		count of popped values
+		*/
+		std::size_t pop_batch(std::span<T> values) {
+			const std::size_t head{ consumer_.head_.load(std::memory_order_relaxed) };
+			const std::size_t count{ std::min(values.size(), ReadyCount(head, values.size())) };
+			if (count == 0) { return 0; }
+
+			const std::size_t index{ head & mask_ };
+			const std::size_t first_part{ std::min(count, mask_ + 1 - index) };
+			std::copy_n(std::make_move_iterator(buffer_.get() + index), first_part, values.begin());
+			std::copy_n(std::make_move_iterator(buffer_.get()), count - first_part,
+						values.begin() + static_cast<std::ptrdiff_t>(first_part));
+			consumer_.head_.store(head + count, std::memory_order_release);
+			return count;
+		}
+
+		std::size_t capacity() const noexcept { return mask_ + 1; }
+
+		/** Approximate count of values, if it is called not by producer or consumer. */
+		std::size_t size() const noexcept {
+			const std::size_t head{ consumer_.head_.load(std::memory_order_acquire) };
+			const std::size_t tail{ producer_.tail_.load(std::memory_order_acquire) };
+			return tail - head;
+		}
+
+		bool empty() const noexcept { return size() == 0; }
+
+	private:
+		/** Count of free cells for producer. Reloads head only, if cached copy says, that there is not enough. */
+		std::size_t FreeCount(std::size_t tail, std::size_t wanted) noexcept {
+			std::size_t free_count{ capacity() - (tail - producer_.cached_head_) };
+			if (free_count < wanted) {
+				producer_.cached_head_ = consumer_.head_.load(std::memory_order_acquire);
+				free_count = capacity() - (tail - producer_.cached_head_);
+			}
+			return free_count;
+		}
+
+		/** Count of values for consumer. Reloads tail only, if cached copy says, that there is not enough. */
+		std::size_t ReadyCount(std::size_t head, std::size_t wanted) noexcept {
+			std::size_t ready_count{ consumer_.cached_tail_ - head };
+			if (ready_count < wanted) {
+				consumer_.cached_tail_ = producer_.tail_.load(std::memory_order_acquire);
+				ready_count = consumer_.cached_tail_ - head;
+			}
+			return ready_count;
+		}
+
+		/** Data of producer: written by producer, tail_ is read by consumer. */
+		struct alignas(kCacheLineSize) Producer {
+			std::atomic<std::size_t> tail_{ 0 };
+			std::size_t cached_head_{ 0 };
+		};
+
+		/** Data of consumer: written by consumer, head_ is read by producer. */
+		struct alignas(kCacheLineSize) Consumer {
+			std::atomic<std::size_t> head_{ 0 };
+			std::size_t cached_tail_{ 0 };
+		};
+
+		const std::size_t mask_;
+		const std::unique_ptr<T[]> buffer_;
+		Producer producer_{};
+		Consumer consumer_{};
+	}; // !class SpscQueue
+
+} // !namespace conc
+
+#endif // !SPSC_QUEUE_HPP
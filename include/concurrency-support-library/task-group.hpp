@@ -0,0 +1,152 @@
+﻿#ifndef TASK_GROUP_HPP
+#define TASK_GROUP_HPP
+
+#include <atomic>
+#include <cstddef>		// size_t
+#include <exception>	// exception_ptr
+#include <utility>		// forward, move, exchange
+
+#include "concurrency-support-library/hardware.hpp"
+#include "concurrency-support-library/thread.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/**
+	* Fork-join group of tasks on thread pool.
+	* run() submits task, wait() waits all tasks of group. Waiting thread executes pending tasks of pool instead
+	* of blocking, so recursive divide-and-conquer code and nested parallel loops don't create threads and
+	* don't block workers.
+	* The first exception of tasks is rethrown by wait().
+	* Destructor waits all tasks, but doesn't rethrow.
+	*
+	* Example:
+	* int Fib(int n) {
+	*	if (n < 2) { return n; }
+	*	int a{}, b{};
+	*	conc::task_group group{};
+	*	group.run([&a, n]() { a = Fib(n - 1); });
+	*	b = Fib(n - 2);
+	*	group.wait();
+	*	return a + b;
+	* }
+	*/
+	class task_group {
+	public:
+		explicit task_group(util::thread::ThreadPool& pool = util::thread::DefaultThreadPool()) noexcept
+			: pool_{ pool } {
+		}
+
+		task_group(const task_group&) = delete;
+		task_group& operator=(const task_group&) = delete;
+		task_group(task_group&&) noexcept = delete;
+		task_group& operator=(task_group&&) noexcept = delete;
+
+		~task_group() { WaitTasks(); }
+
+		/** Submit task to pool. Callable is copied or moved. */
+		template<typename FuncT>
+		void run(FuncT&& func) {
+			Submit([this](auto&& task) { pool_.post(std::move(task)); }, std::forward<FuncT>(func));
+		}
+
+		/** Submit task to worker of pool, see ThreadPool::post_to(). */
+		template<typename FuncT>
+		void run_on(std::size_t worker_index, FuncT&& func) {
+			Submit([this, worker_index](auto&& task) { pool_.post_to(worker_index, std::move(task)); },
+					std::forward<FuncT>(func));
+		}
+
+		/** Wait all tasks and rethrow the first exception of tasks. Group can be used again after wait. */
+		void wait() {
+			WaitTasks();
+			if (has_exception_.load(std::memory_order_acquire)) {
+				std::exception_ptr exception{ std::exchange(exception_, nullptr) };
+				has_exception_.store(false, std::memory_order_relaxed);
+				first_exception_.store(false, std::memory_order_relaxed); // all tasks are finished
+				std::rethrow_exception(exception);
+			}
+		}
+
+		util::thread::ThreadPool& pool() const noexcept { return pool_; }
+
+	private:
+		/** Tries of pending tasks before sleep. */
+		static constexpr int kSpinCount{ 64 };
+
+		/**
+		* Execute pending tasks of pool, until tasks of group are done.
+		* If there is nothing to execute, tasks of group are executed by other threads. Then sleep until the end.
+		*/
+		void WaitTasks() noexcept {
+			int idle_count{ 0 };
+			while (true) {
+				const std::size_t pending{ pending_.load(std::memory_order_acquire) };
+				if (pending == 0) {
+					while (finishing_.load(std::memory_order_acquire) != 0) { CpuRelax(); } // group may be destroyed
+					return;
+				}
+				try {
+					if (pool_.try_run_pending_task()) {
+						idle_count = 0;
+						continue;
+					}
+				} catch (...) { // only task without handler throws
+					std::terminate();
+				}
+				if (++idle_count < kSpinCount) {
+					CpuRelax();
+				} else {
+					pending_.wait(pending, std::memory_order_acquire);
+				}
+			}
+		}
+
+		template<typename PostFuncT, typename FuncT>
+		void Submit(PostFuncT&& post_func, FuncT&& func) {
+			pending_.fetch_add(1, std::memory_order_relaxed);
+			try {
+				post_func([this, func = std::forward<FuncT>(func)]() mutable {
+					try {
+						func();
+					} catch (...) {
+						SaveException(std::current_exception());
+					}
+					Finish();
+				});
+			} catch (...) {
+				pending_.fetch_sub(1, std::memory_order_relaxed);
+				throw;
+			}
+		}
+
+		/**
+		* Decrease count of pending tasks. Wake waiters, when it is the last task.
+		* finishing_ guards group from destruction, until notify is done.
+		*/
+		void Finish() noexcept {
+			finishing_.fetch_add(1, std::memory_order_relaxed);
+			if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) { pending_.notify_all(); }
+			finishing_.fetch_sub(1, std::memory_order_release); // the last access to group
+		}
+
+		void SaveException(std::exception_ptr exception) noexcept {
+			bool expected{ false };
+			if (first_exception_.compare_exchange_strong(expected, true, std::memory_order_relaxed)) {
+				exception_ = exception;
+				has_exception_.store(true, std::memory_order_release);
+			}
+		}
+
+		util::thread::ThreadPool& pool_;
+		alignas(kCacheLineSize) std::atomic<std::size_t> pending_{ 0 };
+		std::atomic<std::size_t> finishing_{ 0 };
+		std::atomic<bool> first_exception_{ false };
+		std::atomic<bool> has_exception_{ false };
+		std::exception_ptr exception_{};
+	};
+
+} // !namespace conc
+
+#endif // !TASK_GROUP_HPP
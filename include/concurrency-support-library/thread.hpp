@@ -1,113 +1,1285 @@
 ﻿#ifndef THREAD_HPP
 #define THREAD_HPP
 
-//#include <string>	// CustomException
-//#include <exception> // CustomException
-//#include <stdexcept> // different exception types
+#include <algorithm>	// max, push_heap, pop_heap
+#include <array>
+#include <atomic>
+#include <bit>			// bit_ceil
+#include <chrono>		// steady_clock
+#include <coroutine>	// coroutine_handle
+#include <cstddef>		// size_t, ptrdiff_t
+#include <cstdint>		// uint32_t, uint64_t
+#include <functional>	// invoke, hash
+#include <future>		// packaged_task, future
+#include <memory>		// unique_ptr
+#include <mutex>		// mutex, lock_guard
+#include <exception>	// exception_ptr
+#include <new>			// launder, align_val_t
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <type_traits>	// invoke_result_t, decay_t, conditional_t, is_nothrow_move_constructible_v
+#include <utility>		// move, forward, exchange, in_place
+#include <variant>		// monostate
+#include <vector>
+
+#include "concurrency-support-library/hardware.hpp"
+#include "concurrency-support-library/metrics.hpp"
+#include "concurrency-support-library/slot-allocator.hpp"
+#include "concurrency-support-library/topology.hpp"
+#include "concurrency-support-library/work-stealing-deque.hpp"
+
 
 namespace util {
 
 	namespace thread {
-		/*
-	#include <thread>
-	#include <vector>
-	#include <queue>
-	#include <functional>
-	#include <future>
-	#include <mutex>
-	#include <condition_variable>
-	#include <atomic>
-
-				class ThreadPool {
-				private:
-					using Task = std::function<void()>;
-
-					std::vector<std::thread> workers_;           // Рабочие потоки
-					std::queue<Task> task_queue_;                 // Очередь задач
-					std::mutex queue_mutex_;                      // Мьютекс для защиты очереди
-					std::condition_variable condition_;          // Условная переменная для уведомления потоков
-					std::atomic<bool> stop_{ false };              // Флаг остановки потока
-
-				public:
-					explicit ThreadPool(size_t thread_count)
-						: workers_(thread_count) {
-						for (size_t i = 0; i < thread_count; ++i) {
-							workers_[i] = std::thread([this]() {
-								while (!stop_) {
-									Task task;
-									{
-										std::unique_lock<std::mutex> lock(queue_mutex_);
-										condition_.wait(lock, [this]() { return !task_queue_.empty() || stop_; });
-
-										if (stop_ && task_queue_.empty()) break;
-
-										task = std::move(task_queue_.front());
-										task_queue_.pop();
-									}
 
-									task();  // Выполняем задачу вне мьютекса
-								}
-								});
+		class ThreadPool;
+
+		namespace detail {
+
+			/** Pool and index of current worker thread. */
+			struct WorkerContext {
+				const ThreadPool* pool{ nullptr };
+				std::size_t index{ static_cast<std::size_t>(-1) };
+			};
+
+			/** Size of slot for task: header of task and about 64 bytes of closure and result. */
+			inline constexpr std::size_t kTaskSlotSize{ 2 * conc::kCacheLineSize };
+
+			/**
+			* Type erased task of ThreadPool.
+			* Intrusive node: next_ links tasks in TaskInbox without extra allocation.
+			* Task owns itself: Run() frees task, that was allocated by pool. Task, that lives in other object
+			* (awaiter in coroutine frame), is not freed, so pool doesn't allocate for it.
+			* Task, that fits kTaskSlotSize, is placed in slot of SlotAllocator, bigger one - in heap.
+			*/
+			class TaskBase {
+			public:
+				TaskBase() = default;
+				TaskBase(const TaskBase&) = delete;
+				TaskBase& operator=(const TaskBase&) = delete;
+				TaskBase(TaskBase&&) noexcept = delete;
+				TaskBase& operator=(TaskBase&&) noexcept = delete;
+				virtual ~TaskBase() = default;
+
+				static void* operator new(std::size_t size) {
+					return size <= kTaskSlotSize ? TaskSlots::Allocate() : ::operator new(size);
+				}
+				static void* operator new(std::size_t size, std::align_val_t alignment) {
+					return FitsSlot(size, alignment) ? TaskSlots::Allocate() : ::operator new(size, alignment);
+				}
+				static void operator delete(void* pointer, std::size_t size) noexcept {
+					if (size <= kTaskSlotSize) {
+						TaskSlots::Deallocate(pointer);
+					} else {
+						::operator delete(pointer, size);
+					}
+				}
+				static void operator delete(void* pointer, std::size_t size, std::align_val_t alignment) noexcept {
+					if (FitsSlot(size, alignment)) {
+						TaskSlots::Deallocate(pointer);
+					} else {
+						::operator delete(pointer, size, alignment);
+					}
+				}
+
+				/** Execute and free task. Task must not be used after Run(). Exception terminates the program. */
+				virtual void Run() = 0;
+
+				/** Next task in TaskInbox list. */
+				TaskBase* next_{ nullptr };
+				/** Time of submit in ns of steady_clock, if task is sampled for latency metrics. 0 - not sampled. */
+				std::uint64_t enqueue_time_{ 0 };
+
+			private:
+				using TaskSlots = conc::SlotAllocator<kTaskSlotSize>;
+
+				static constexpr bool FitsSlot(std::size_t size, std::align_val_t alignment) noexcept {
+					return size <= kTaskSlotSize && static_cast<std::size_t>(alignment) <= conc::kCacheLineSize;
+				}
+			};
+
+			/** Task, that stores callable object of any type. */
+			template<typename FuncT>
+			class Task final : public TaskBase {
+			public:
+				template<typename InitFuncT>
+				explicit Task(InitFuncT&& func) : func_{ std::forward<InitFuncT>(func) } {}
+
+				void Run() override {
+					std::unique_ptr<Task> self{ this }; // is freed even if func throws
+					std::invoke(func_);
+				}
+
+			private:
+				FuncT func_;
+			};
+
+
+			/** Part of FutureState, that doesn't depend on type of result: continuation. */
+			class FutureStateBase : public TaskBase {
+			public:
+				/** Run continuation, when state becomes ready. If it is ready already, continuation is run at once. */
+				void SetContinuation(TaskBase* continuation) noexcept {
+					TaskBase* expected{ nullptr };
+					if (!continuation_.compare_exchange_strong(expected, continuation, std::memory_order_acq_rel,
+																						std::memory_order_acquire)) {
+						continuation->Run(); // ready
+					}
+				}
+
+			protected:
+				void RunContinuation() noexcept {
+					if (TaskBase* continuation{ continuation_.exchange(this, std::memory_order_acq_rel) }) {
+						continuation->Run();
+					}
+				}
+
+			private:
+				/** nullptr - no continuation, this - state is ready, other - continuation. */
+				std::atomic<TaskBase*> continuation_{ nullptr };
+			};
+
+			/**
+			* Shared state of TaskFuture. Is the task itself, so callable, result and state of readiness
+			* are in one slot. Is freed, when task is executed and future is released.
+			* One continuation can be attached: it is run by thread, that makes state ready.
+			*/
+			template<typename T>
+			class FutureState : public FutureStateBase {
+			public:
+				using ValueT = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+				/** @param references		count of owners: future and producers of result */
+				explicit FutureState(std::uint32_t references = 2) noexcept : references_{ references } {}
+
+				bool IsReady() const noexcept { return ready_.load(std::memory_order_acquire) != 0; }
+
+				void Wait() const noexcept {
+					while (ready_.load(std::memory_order_acquire) == 0) { ready_.wait(0, std::memory_order_acquire); }
+				}
+
+				/** Only once. Wait result. */
+				T Get() {
+					Wait();
+					if (exception_) { std::rethrow_exception(exception_); }
+					if constexpr (!std::is_void_v<T>) { return std::move(*value_); }
+				}
+
+				/** Is called by task and by future. The last one frees state. */
+				void Release() noexcept {
+					if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) { delete this; }
+				}
+
+			protected:
+				/** Execute func, store result and wake waiting thread. */
+				template<typename FuncT>
+				void Complete(FuncT& func) noexcept {
+					try {
+						if constexpr (std::is_void_v<T>) {
+							std::invoke(func);
+							value_.emplace();
+						} else {
+							value_.emplace(std::invoke(func));
 						}
+					} catch (...) {
+						exception_ = std::current_exception();
+					}
+				}
+
+				/** Make state ready: wake waiting threads and run continuation. Producer releases state after. */
+				void Publish() noexcept {
+					ready_.store(1, std::memory_order_release);
+					ready_.notify_all();
+					RunContinuation();
+				}
+
+			private:
+				std::optional<ValueT> value_{};
+				std::exception_ptr exception_{};
+				std::atomic<std::uint32_t> ready_{ 0 };
+				std::atomic<std::uint32_t> references_;
+			};
+
+			template<typename FuncT, typename T>
+			class FutureTask final : public FutureState<T> {
+			public:
+				template<typename InitFuncT>
+				explicit FutureTask(InitFuncT&& func) : func_{ std::in_place, std::forward<InitFuncT>(func) } {}
+
+				void Run() override {
+					this->Complete(*func_);
+					func_.reset(); // captures are freed before waiting thread continues
+					this->Publish();
+					this->Release();
+				}
+
+			private:
+				std::optional<FuncT> func_;
+			};
+
+			/** Access of combinators to state of TaskFuture. */
+			struct FutureAccess {
+				template<typename FutureT>
+				static auto* State(FutureT& future) noexcept { return future.state_; }
+			};
+
+		} // !namespace detail
+
+
+		/**
+		* Result of ThreadPool::submit(). Light alternative of std::future: state is stored in slot of task,
+		* so there is no extra allocation.
+		* then() chains dependent work without blocking thread on get(). Combinators are in future.hpp.
+		*/
+		template<typename T>
+		class [[nodiscard]] TaskFuture {
+		public:
+			TaskFuture() noexcept = default;
+			explicit TaskFuture(detail::FutureState<T>* state) noexcept : state_{ state } {}
+
+			TaskFuture(const TaskFuture&) = delete;
+			TaskFuture& operator=(const TaskFuture&) = delete;
+
+			TaskFuture(TaskFuture&& other) noexcept : state_{ std::exchange(other.state_, nullptr) } {}
+			TaskFuture& operator=(TaskFuture&& other) noexcept {
+				if (this != &other) {
+					Reset();
+					state_ = std::exchange(other.state_, nullptr);
+				}
+				return *this;
+			}
+
+			~TaskFuture() { Reset(); }
+
+			/** Future has state: it is returned by submit() and get() was not called. */
+			bool valid() const noexcept { return state_ != nullptr; }
+
+			bool is_ready() const noexcept { return state_->IsReady(); }
+
+			void wait() const noexcept { state_->Wait(); }
+
+			/** Wait result and return it or rethrow exception of task. Future becomes not valid. */
+			T get() {
+				struct Releaser {
+					~Releaser() { future.Reset(); }
+					TaskFuture& future;
+				} releaser{ *this };
+				return state_->Get();
+			}
+
+			/**
+			* Attach continuation: func(TaskFuture<T>&& ready_future). Future becomes not valid.
+			* Continuation is executed by thread, that completes this future, usually worker of pool.
+			* If result is ready already, continuation is executed at once by current thread.
+			*
+			* @return		future of result of continuation
+			*/
+			template<typename FuncT>
+			auto then(FuncT&& func) -> TaskFuture<std::invoke_result_t<std::decay_t<FuncT>, TaskFuture<T>>> {
+				using ReturnT = std::invoke_result_t<std::decay_t<FuncT>, TaskFuture<T>>;
+
+				detail::FutureState<T>* antecedent{ state_ };
+				auto continuation_func{ [func = std::forward<FuncT>(func), future = std::move(*this)]() mutable -> ReturnT {
+					return std::invoke(std::move(func), std::move(future));
+				} };
+				auto* continuation{ new detail::FutureTask<decltype(continuation_func), ReturnT>(
+					std::move(continuation_func)) };
+				TaskFuture<ReturnT> result{ continuation };
+				antecedent->SetContinuation(continuation);
+				return result;
+			}
+
+		private:
+			friend struct detail::FutureAccess;
+
+			void Reset() noexcept {
+				if (state_) { std::exchange(state_, nullptr)->Release(); }
+			}
+
+			detail::FutureState<T>* state_{ nullptr };
+		};
+
+
+		namespace detail {
+
+
+			/**
+			* Lock-free inbox for tasks from threads, that are not workers of pool.
+			* Producers push by one CAS. Consumer takes the whole list by one exchange, so there is no ABA problem
+			* and any thread can be consumer. Count of tasks is kept apart from list, only for metrics.
+			*/
+			class TaskInbox {
+			public:
+				void Push(TaskBase* task) noexcept {
+					task->next_ = head_.load(std::memory_order_relaxed);
+					while (!head_.compare_exchange_weak(task->next_, task, std::memory_order_release,
+																			std::memory_order_relaxed)) {
 					}
+					size_.fetch_add(1, std::memory_order_relaxed);
+				}
 
-					~ThreadPool() {
-						stop_ = true;
-						condition_.notify_all();
-						for (auto& worker : workers_)
-							worker.join();
+				/** @return		list of all tasks in order of pushing or nullptr */
+				TaskBase* TakeAll() noexcept {
+					TaskBase* list{ head_.exchange(nullptr, std::memory_order_acquire) };
+					TaskBase* reversed{ nullptr };
+					std::int64_t count{ 0 };
+					while (list) {
+						TaskBase* next{ list->next_ };
+						list->next_ = reversed;
+						reversed = list;
+						list = next;
+						++count;
 					}
+					if (count != 0) { size_.fetch_sub(count, std::memory_order_relaxed); }
+					return reversed;
+				}
+
+				bool Empty() const noexcept { return head_.load(std::memory_order_relaxed) == nullptr; }
+
+				/** Approximate count of tasks. Counter may lag behind list for a moment. */
+				std::size_t Size() const noexcept {
+					const std::int64_t size{ size_.load(std::memory_order_relaxed) };
+					return size > 0 ? static_cast<std::size_t>(size) : 0;
+				}
+
+			private:
+				std::atomic<TaskBase*> head_{ nullptr };
+				std::atomic<std::int64_t> size_{ 0 };
+			};
+
+		} // !namespace detail
+
+
+		/**
+		* Bounded multi-producer multi-consumer queue. Lock-free, no allocation after construction.
+		*
+		* Ring of cells, every cell has sequence number, that tells, whose turn it is: producer of position or
+		* consumer of position. Producers and consumers claim positions by CAS on own counters, so producers don't
+		* wait consumers and vice versa, when queue is neither full nor empty.
+		* Blocking push() and pop() spin for a while, than park on atomic wait. Opposite side wakes parked threads
+		* only if there are such ones, so there is no system call in fast path.
+		*
+		* http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+		*
+		* @param T		move constructor must not throw
+		*/
+		template<typename T>
+		class TasksQueue {
+			static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
 
-					template<typename F, typename... Args>
-					auto enqueue(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type> {
-						using ReturnT = typename std::invoke_result<F, Args...>::type;
+		public:
+			/** @param capacity		is rounded up to power of two, the least capacity is 2 */
+			explicit TasksQueue(std::size_t capacity)
+				: mask_{ std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1 },
+				  cells_{ std::make_unique<Cell[]>(mask_ + 1) }
+			{
+				for (std::size_t i = 0; i <= mask_; ++i) { cells_[i].sequence_.store(i, std::memory_order_relaxed); }
+			}
 
-						auto task = std::make_shared<std::packaged_task<ReturnT()>>(
-							std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+			TasksQueue(const TasksQueue&) = delete;
+			TasksQueue& operator=(const TasksQueue&) = delete;
+			TasksQueue(TasksQueue&&) noexcept = delete;
+			TasksQueue& operator=(TasksQueue&&) noexcept = delete;
 
-						std::future<ReturnT> result = task->get_future();
-						{
-							std::lock_guard<std::mutex> lock(queue_mutex_);
-							task_queue_.emplace([task]() { (*task)(); });
+			~TasksQueue() {
+				while (try_pop()) {}
+			}
+
+			/** @return		false, if queue is full. Value is not changed then */
+			bool try_push(T&& value) noexcept { return TryEmplace(std::move(value)); }
+
+			/** @return		false, if queue is full */
+			bool try_push(const T& value) {
+				if constexpr (std::is_nothrow_copy_constructible_v<T>) {
+					return TryEmplace(value);
+				} else { // copy before claiming cell: cell can't be left not constructed
+					T copy{ value };
+					return TryEmplace(std::move(copy));
+				}
+			}
+
+			/** @return		the oldest value or nullopt, if queue is empty */
+			std::optional<T> try_pop() noexcept {
+				std::size_t position{ dequeue_position_.load(std::memory_order_relaxed) };
+				while (true) {
+					Cell& cell{ cells_[position & mask_] };
+					const std::size_t sequence{ cell.sequence_.load(std::memory_order_acquire) };
+					const auto difference{ static_cast<std::ptrdiff_t>(sequence - (position + 1)) };
+					if (difference == 0) {
+						if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+							T* stored{ cell.Value() };
+							std::optional<T> result{ std::move(*stored) };
+							stored->~T();
+							cell.sequence_.store(position + mask_ + 1, std::memory_order_release); // free for producer
+							Notify(pushers_);
+							return result;
 						}
-						condition_.notify_one();
-						return result;
+					} else if (difference < 0) { // producer of position has not come
+						return std::nullopt;
+					} else { // other consumer took position
+						position = dequeue_position_.load(std::memory_order_relaxed);
 					}
+				}
+			}
+
+			/** Wait, while queue is full. */
+			void push(T&& value) {
+				Wait(pushers_, [this, &value]() { return try_push(std::move(value)); });
+			}
+
+			void push(const T& value) {
+				T copy{ value };
+				push(std::move(copy));
+			}
+
+			/** Wait, while queue is empty. */
+			T pop() {
+				std::optional<T> result{};
+				Wait(poppers_, [this, &result]() {
+					result = try_pop();
+					return result.has_value();
+				});
+				return std::move(*result);
+			}
+
+			std::size_t capacity() const noexcept { return mask_ + 1; }
+
+			/** Approximate count of values: queue may change at the same time. */
+			std::size_t size() const noexcept {
+				const std::size_t dequeue_position{ dequeue_position_.load(std::memory_order_relaxed) };
+				const std::size_t enqueue_position{ enqueue_position_.load(std::memory_order_relaxed) };
+				const auto size{ static_cast<std::ptrdiff_t>(enqueue_position - dequeue_position) };
+				return size > 0 ? static_cast<std::size_t>(size) : 0;
+			}
+
+			bool empty() const noexcept { return size() == 0; }
+
+		private:
+			/** Tries before sleep. */
+			static constexpr int kSpinCount{ 64 };
+
+			struct alignas(conc::kCacheLineSize) Cell {
+				T* Value() noexcept { return std::launder(reinterpret_cast<T*>(storage_)); }
+
+				std::atomic<std::size_t> sequence_{ 0 };
+				alignas(T) unsigned char storage_[sizeof(T)];
+			};
+
+			/** Threads, that sleep waiting one side of queue. */
+			struct alignas(conc::kCacheLineSize) Sleepers {
+				std::atomic<std::uint32_t> epoch_{ 0 };
+				std::atomic<std::uint32_t> count_{ 0 };
+			};
 
-					void shutdown() {
-						stop_ = true;
-						condition_.notify_all();
-						for (auto& worker : workers_)
-							worker.join();
+			template<typename... ArgsT>
+			bool TryEmplace(ArgsT&&... args) noexcept {
+				std::size_t position{ enqueue_position_.load(std::memory_order_relaxed) };
+				while (true) {
+					Cell& cell{ cells_[position & mask_] };
+					const std::size_t sequence{ cell.sequence_.load(std::memory_order_acquire) };
+					const auto difference{ static_cast<std::ptrdiff_t>(sequence - position) };
+					if (difference == 0) {
+						if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+							::new (static_cast<void*>(cell.storage_)) T(std::forward<ArgsT>(args)...);
+							cell.sequence_.store(position + 1, std::memory_order_release); // publish to consumer
+							Notify(poppers_);
+							return true;
+						}
+					} else if (difference < 0) { // consumer of previous round has not come
+						return false;
+					} else { // other producer took position
+						position = enqueue_position_.load(std::memory_order_relaxed);
 					}
-				};
+				}
+			}
+
+			/** Spin, than sleep, until try_func succeeds. */
+			template<typename TryFuncT>
+			void Wait(Sleepers& sleepers, TryFuncT&& try_func) {
+				for (int spin = 0; spin < kSpinCount; ++spin) {
+					if (try_func()) { return; }
+					conc::CpuRelax();
+				}
+				while (true) {
+					const std::uint32_t epoch{ sleepers.epoch_.load(std::memory_order_acquire) };
+					sleepers.count_.fetch_add(1, std::memory_order_seq_cst);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (try_func()) {
+						sleepers.count_.fetch_sub(1, std::memory_order_relaxed);
+						return;
+					}
+					sleepers.epoch_.wait(epoch, std::memory_order_acquire);
+					sleepers.count_.fetch_sub(1, std::memory_order_relaxed);
+				}
+			}
+
+			/** Wake one sleeper. No system call, if nobody sleeps. */
+			static void Notify(Sleepers& sleepers) noexcept {
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (sleepers.count_.load(std::memory_order_relaxed) > 0) {
+					sleepers.epoch_.fetch_add(1, std::memory_order_release);
+					sleepers.epoch_.notify_one();
+				}
+			}
 
-				// Простое использование
-				int main() {
-					ThreadPool pool(4); // Используем 4 потока
+			const std::size_t mask_;
+			const std::unique_ptr<Cell[]> cells_;
+			alignas(conc::kCacheLineSize) std::atomic<std::size_t> enqueue_position_{ 0 };
+			alignas(conc::kCacheLineSize) std::atomic<std::size_t> dequeue_position_{ 0 };
+			Sleepers pushers_{};
+			Sleepers poppers_{};
+		}; // !class TasksQueue
 
-					// Добавляем задачу в пул
-					auto future = pool.enqueue([]() {
-						std::this_thread::sleep_for(std::chrono::seconds(2)); // Имитация длительной задачи
-						return 42;
-						});
 
-					// Ждем завершения задачи
-					int result = future.get();
-					std::cout << "Result is: " << result << std::endl;
+		/** Counters of one worker of ThreadPool. */
+		struct WorkerMetrics {
+			std::uint64_t tasks_executed{ 0 };
+			/** Visits of queues of other workers and tasks taken there. */
+			std::uint64_t steals_attempted{ 0 };
+			std::uint64_t steals_succeeded{ 0 };
+			/** Sleeps on atomic wait after spinning. */
+			std::uint64_t parks{ 0 };
+			/** Wake ups of this worker by other threads, that needed system call. */
+			std::uint64_t unparks{ 0 };
+			/** Tasks in deque and inbox of worker, all priority classes. Estimate at time of snapshot. */
+			std::size_t queue_depth{ 0 };
+			std::chrono::nanoseconds busy_time{ 0 };
+			/** Time of search of task: spinning and parking. */
+			std::chrono::nanoseconds idle_time{ 0 };
+		};
 
-					return 0;
+		/** Snapshot of metrics of ThreadPool. */
+		struct ThreadPoolMetrics {
+			/** Sum of counters of all workers. */
+			WorkerMetrics total() const noexcept {
+				WorkerMetrics sum{};
+				for (const WorkerMetrics& worker : workers) {
+					sum.tasks_executed += worker.tasks_executed;
+					sum.steals_attempted += worker.steals_attempted;
+					sum.steals_succeeded += worker.steals_succeeded;
+					sum.parks += worker.parks;
+					sum.unparks += worker.unparks;
+					sum.queue_depth += worker.queue_depth;
+					sum.busy_time += worker.busy_time;
+					sum.idle_time += worker.idle_time;
 				}
+				return sum;
+			}
 
-				*/
+			std::vector<WorkerMetrics> workers{};
+			/** Time from submit to start of task, ns. Only sampled tasks. */
+			conc::LatencyHistogram queue_latency{};
+			/** Time of execution of task, ns. Only sampled tasks. */
+			conc::LatencyHistogram execution_time{};
+			/** Wake ups of parked workers, that needed system call. Sum of unparks of workers. */
+			std::uint64_t notifies{ 0 };
+			/** Tasks with deadline, that wait in common heap. They are not in queue_depth of workers. */
+			std::size_t deadline_tasks{ 0 };
+			std::chrono::nanoseconds uptime{ 0 };
+		};
 
-		class TasksQueue {
 
+		/** Priority class of task. More urgent classes are executed first. */
+		enum class TaskPriority : std::uint8_t {
+			kHigh,		// latency-critical
+			kNormal,
+			kLow		// batch work
 		};
 
-		class ThreadPool {
-			// Best count of threads is: max threads of CPU + 1 (or 2)
+
+		/** Placement of workers of pool on CPUs. */
+		enum class WorkerAffinity : std::uint8_t {
+			kNone,		// system moves workers freely
+			kCores,		// every worker is pinned to one CPU
+			kNumaNodes	// every worker is pinned to CPUs of one NUMA node
 		};
+
+
+		/**
+		* Pool of persistent threads with work-stealing.
+		*
+		* Every worker has own Chase-Lev deque. Task, submitted by worker, is pushed to deque of this worker.
+		* Task, submitted by other thread, is pushed to lock-free inbox of one of workers.
+		* Idle worker steals tasks from deques of other workers and from inboxes of busy workers. So there is
+		* no global lock and no single queue, that all threads fight for.
+		* Idle worker spins for a while, than parks on own atomic. Task of inbox wakes owner of inbox, if it is
+		* parked, other tasks wake any parked worker. No system call, if nobody sleeps.
+		*
+		* Every priority class has own deques and inboxes, worker looks for task from high class to low one.
+		* Tasks with deadline are executed before tasks of high class, earliest deadline first. Running tasks are
+		* not preempted. Every kAgingPeriod-th search begins from lower class, so starvation of low classes
+		* is bounded.
+		*
+		* Workers can be pinned to CPUs. Workers are spread over NUMA nodes by contiguous groups: workers with
+		* near indices are on the same node. Memory is placed on node of thread, that touches it first, so data,
+		* that is initialized and processed by the same static schedule of for_parallel, stays local.
+		*
+		* Tasks, that are not executed before destruction of pool, are executed in destructor.
+		*
+		* Pool collects metrics all the time: every worker writes own counters without atomic RMW, and only every
+		* kLatencySamplePeriod-th submitted task reads clock for latency histograms. metrics() reads them.
+		*/
+		class ThreadPool {
+		public:
+			/** Index of thread, that is not worker of pool. */
+			static constexpr std::size_t kNotWorker{ static_cast<std::size_t>(-1) };
+			static constexpr std::size_t kPrioritiesCount{ 3 };
+			/** Every kAgingPeriod-th search of task begins from lower priority class. */
+			static constexpr std::uint32_t kAgingPeriod{ 8 };
+			/** Every kLatencySamplePeriod-th submitted task of thread is measured for latency histograms. */
+			static constexpr std::uint32_t kLatencySamplePeriod{ 16 };
+
+			using Clock = std::chrono::steady_clock;
+
+			/** @param threads_count		count of workers. Best count of threads is count of hardware threads. */
+			explicit ThreadPool(std::size_t threads_count = DefaultThreadsCount())
+				: ThreadPool(threads_count, WorkerAffinity::kNone) {
+			}
+
+			/** @param affinity		placement of workers. Topology is read from /sys/devices/system/node */
+			ThreadPool(std::size_t threads_count, WorkerAffinity affinity) {
+				if (threads_count == 0) { threads_count = 1; }
+				workers_.reserve(threads_count);
+				for (std::size_t i = 0; i < threads_count; ++i) {
+					workers_.emplace_back(std::make_unique<Worker>(i));
+				}
+				if (affinity != WorkerAffinity::kNone) { PlaceWorkers(affinity, conc::CpuTopology::Discover()); }
+				try {
+					for (std::size_t i = 0; i < threads_count; ++i) { // all workers exist before the first thread
+						workers_[i]->thread_ = std::thread{ &ThreadPool::WorkerLoop, this, i };
+					}
+				} catch (...) {
+					shutdown();
+					throw;
+				}
+			}
+
+			ThreadPool(const ThreadPool&) = delete;
+			ThreadPool& operator=(const ThreadPool&) = delete;
+			ThreadPool(ThreadPool&&) noexcept = delete;
+			ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+			~ThreadPool() { shutdown(); }
+
+			/**
+			* Submit task to pool.
+			* Exception of task is stored in future.
+			*
+			* @param func		callable object
+			* @param args		arguments are copied or moved to task
+			* @return			future with result of func call
+			*/
+			template<typename FuncT, typename... ArgsT>
+			auto enqueue(FuncT&& func, ArgsT&&... args)
+					-> std::future<std::invoke_result_t<std::decay_t<FuncT>, std::decay_t<ArgsT>...>>
+			{
+				return enqueue(TaskPriority::kNormal, std::forward<FuncT>(func), std::forward<ArgsT>(args)...);
+			}
+
+			/** Submit task of priority class to pool. */
+			template<typename FuncT, typename... ArgsT>
+			auto enqueue(TaskPriority priority, FuncT&& func, ArgsT&&... args)
+					-> std::future<std::invoke_result_t<std::decay_t<FuncT>, std::decay_t<ArgsT>...>>
+			{
+				using ReturnT = std::invoke_result_t<std::decay_t<FuncT>, std::decay_t<ArgsT>...>;
+
+				std::packaged_task<ReturnT()> task{
+					[func = std::forward<FuncT>(func), ...args = std::forward<ArgsT>(args)]() mutable -> ReturnT {
+						return std::invoke(std::move(func), std::move(args)...);
+					} };
+				std::future<ReturnT> result{ task.get_future() };
+				post(priority, std::move(task));
+				return result;
+			}
+
+			/**
+			* Submit task and get light future. Small task with its result is placed in one slot without
+			* allocation, so it is cheaper, than enqueue.
+			*/
+			template<typename FuncT, typename... ArgsT>
+			auto submit(FuncT&& func, ArgsT&&... args)
+					-> TaskFuture<std::invoke_result_t<std::decay_t<FuncT>, std::decay_t<ArgsT>...>>
+			{
+				using ReturnT = std::invoke_result_t<std::decay_t<FuncT>, std::decay_t<ArgsT>...>;
+
+				auto bound_func{ [func = std::forward<FuncT>(func), ...args = std::forward<ArgsT>(args)]() mutable -> ReturnT {
+					return std::invoke(std::move(func), std::move(args)...);
+				} };
+				auto* task{ new detail::FutureTask<decltype(bound_func), ReturnT>(std::move(bound_func)) };
+				TaskFuture<ReturnT> result{ task };
+				try {
+					Submit(task, TaskPriority::kNormal);
+				} catch (...) {
+					task->Release(); // reference of task
+					throw;
+				}
+				return result;
+			}
+
+			/**
+			* Submit task without result. Cheaper, than enqueue.
+			* Task must not throw.
+			*/
+			template<typename FuncT>
+			void post(FuncT&& func) {
+				post(TaskPriority::kNormal, std::forward<FuncT>(func));
+			}
+
+			template<typename FuncT>
+			void post(TaskPriority priority, FuncT&& func) {
+				std::unique_ptr<detail::TaskBase> task{ MakeTask(std::forward<FuncT>(func)) };
+				Submit(task.get(), priority);
+				task.release();
+			}
+
+			/**
+			* Submit task, that can be cancelled cooperatively. Task is skipped, if stop is requested before start.
+			* Func may accept token: func(std::stop_token), to check it during long work.
+			*/
+			template<typename FuncT>
+			void post(std::stop_token token, FuncT&& func) {
+				post(TaskPriority::kNormal, [token = std::move(token), func = std::forward<FuncT>(func)]() mutable {
+					if (token.stop_requested()) { return; }
+					if constexpr (std::is_invocable_v<FuncT&, std::stop_token>) {
+						std::invoke(func, token);
+					} else {
+						std::invoke(func);
+					}
+				});
+			}
+
+			/**
+			* Submit task to inbox of worker. Worker is woken for it, and other workers don't take it, while the
+			* worker is free. Busy worker leaves it to other worker. So tasks with the same index of worker run on
+			* the same CPU or NUMA node, if the worker is not busy with other task.
+			*/
+			template<typename FuncT>
+			void post_to(std::size_t worker_index, FuncT&& func) {
+				std::unique_ptr<detail::TaskBase> task{ MakeTask(std::forward<FuncT>(func)) };
+				const auto level{ static_cast<std::size_t>(TaskPriority::kNormal) };
+				Sample(task.get());
+				const std::size_t index{ worker_index % workers_.size() };
+				workers_[index]->levels_[level].inbox_.Push(task.get());
+				task.release();
+				NotifyOwner(index);
+			}
+
+			/**
+			* Submit task, that should be done before deadline. Tasks with deadline are executed before all other
+			* tasks, earliest deadline first.
+			*/
+			template<typename FuncT>
+			void post(Clock::time_point deadline, FuncT&& func) {
+				std::unique_ptr<detail::TaskBase> task{ MakeTask(std::forward<FuncT>(func)) };
+				Sample(task.get());
+				{
+					std::lock_guard<std::mutex> lock{ deadline_mutex_ };
+					deadline_tasks_.push_back(DeadlineTask{ deadline, deadline_sequence_++, task.get() });
+					std::push_heap(deadline_tasks_.begin(), deadline_tasks_.end(), DeadlineTask::Later);
+					deadline_tasks_count_.store(deadline_tasks_.size(), std::memory_order_release);
+				}
+				task.release();
+				NotifyOne();
+			}
+
+			/** Execute all submitted tasks and join workers. Is called by destructor. */
+			void shutdown() {
+				stop_.store(true, std::memory_order_seq_cst);
+				for (auto& worker : workers_) {
+					worker->wake_epoch_.fetch_add(1, std::memory_order_release);
+					worker->wake_epoch_.notify_one();
+				}
+				for (auto& worker : workers_) {
+					if (worker->thread_.joinable()) { worker->thread_.join(); }
+				}
+				while (HasWork()) { // tasks, that came after stop
+					while (detail::TaskBase* task{ TakeDeadlineTask() }) { Execute(task); }
+					for (auto& worker : workers_) {
+						for (Level& level : worker->levels_) {
+							while (detail::TaskBase* task{ level.deque_.pop().value_or(nullptr) }) { Execute(task); }
+							for (detail::TaskBase* task{ level.inbox_.TakeAll() }; task;) {
+								detail::TaskBase* next{ task->next_ };
+								Execute(task);
+								task = next;
+							}
+						}
+					}
+				}
+			}
+
+			/**
+			* Execute one pending task by current thread.
+			* Thread, that waits for results of tasks, helps pool instead of blocking. So nested parallel code
+			* doesn't need more threads and can't block all workers.
+			* Worker takes task from own deque and steals. Other threads only steal.
+			*
+			* @return		true, if task was executed
+			*/
+			bool try_run_pending_task() {
+				detail::TaskBase* task{ nullptr };
+				if (tls_context_.pool == this) {
+					task = FindTask(tls_context_.index);
+				} else {
+					thread_local std::size_t cursor{ std::hash<std::thread::id>{}(std::this_thread::get_id()) };
+					const std::size_t start{ cursor++ };
+					task = TakeDeadlineTask();
+					for (std::size_t level = 0; !task && level < kPrioritiesCount; ++level) {
+						for (std::size_t i = 0; !task && i < workers_.size(); ++i) {
+							const std::size_t victim_index{ (start + i) % workers_.size() };
+							Level& victim{ workers_[victim_index]->levels_[level] };
+							task = victim.deque_.steal().value_or(nullptr);
+							if (!task && CanStealInbox(*workers_[victim_index])) {
+								task = victim.inbox_.TakeAll();
+								if (task && task->next_) { // thread without deque returns the rest of inbox back
+									for (detail::TaskBase* rest{ std::exchange(task->next_, nullptr) }; rest;) {
+										victim.inbox_.Push(std::exchange(rest, rest->next_));
+									}
+									NotifyOwner(victim_index);
+								}
+							}
+						}
+					}
+				}
+				if (!task) { return false; }
+				if (tls_context_.pool == this) {
+					Execute(*workers_[tls_context_.index], task);
+				} else {
+					Execute(task);
+				}
+				return true;
+			}
+
+			/**
+			* Awaiter, that resumes coroutine on worker of pool: co_await pool.schedule();
+			* Awaiter is task itself and lives in coroutine frame, so there is no allocation.
+			*/
+			class ScheduleAwaiter final : public detail::TaskBase {
+			public:
+				ScheduleAwaiter(ThreadPool& pool, TaskPriority priority) noexcept : pool_{ pool }, priority_{ priority } {}
+
+				bool await_ready() const noexcept { return false; }
+				void await_suspend(std::coroutine_handle<> handle) {
+					handle_ = handle;
+					pool_.Submit(this, priority_);
+				}
+				void await_resume() const noexcept {}
+
+				void Run() override { handle_.resume(); } // awaiter may be destroyed by coroutine
+
+			private:
+				ThreadPool& pool_;
+				TaskPriority priority_;
+				std::coroutine_handle<> handle_{};
+			};
+
+			/** Continue coroutine on worker of pool. */
+			[[nodiscard]] ScheduleAwaiter schedule(TaskPriority priority = TaskPriority::kNormal) noexcept {
+				return ScheduleAwaiter{ *this, priority };
+			}
+
+			/** Count of workers. */
+			std::size_t size() const noexcept { return workers_.size(); }
+
+			/** @return		id of NUMA node of worker. 0, if workers are not pinned */
+			std::size_t numa_node(std::size_t worker_index) const noexcept {
+				return workers_[worker_index]->numa_node_;
+			}
+
+			/** @return		index of current worker in pool or kNotWorker, if current thread is not worker of pool */
+			std::size_t current_worker_index() const noexcept {
+				return tls_context_.pool == this ? tls_context_.index : kNotWorker;
+			}
+
+			/**
+			* Snapshot of metrics. Counters are read one by one without stopping workers, so they may be
+			* slightly inconsistent with each other, while pool is busy. Tasks, that are executed by threads,
+			* that are not workers (try_run_pending_task), are not counted.
+			*/
+			ThreadPoolMetrics metrics() const {
+				const std::uint64_t now{ NowNs() };
+				ThreadPoolMetrics result{};
+				result.uptime = std::chrono::nanoseconds{ now - start_time_ };
+				result.notifies = notifies_.load(std::memory_order_relaxed);
+				result.deadline_tasks = deadline_tasks_count_.load(std::memory_order_relaxed);
+				result.workers.reserve(workers_.size());
+				for (const auto& worker : workers_) {
+					const WorkerCounters& counters{ worker->counters_ };
+					WorkerMetrics metrics{};
+					metrics.tasks_executed = counters.tasks_executed_.load();
+					metrics.steals_attempted = counters.steals_attempted_.load();
+					metrics.steals_succeeded = counters.steals_succeeded_.load();
+					metrics.parks = counters.parks_.load();
+					metrics.unparks = worker->unparks_.load(std::memory_order_relaxed);
+					for (const Level& level : worker->levels_) {
+						metrics.queue_depth += level.deque_.size() + level.inbox_.Size();
+					}
+					std::uint64_t idle{ counters.idle_ns_.load() };
+					const std::uint64_t idle_since{ counters.idle_since_.load() };
+					if (idle_since != 0 && now > idle_since) { idle += now - idle_since; } // idle right now
+					idle = std::min(idle, now - start_time_);
+					metrics.idle_time = std::chrono::nanoseconds{ idle };
+					metrics.busy_time = result.uptime - metrics.idle_time;
+					result.workers.push_back(metrics);
+					result.queue_latency.merge(counters.queue_latency_.snapshot());
+					result.execution_time.merge(counters.execution_time_.snapshot());
+				}
+				return result;
+			}
+
+			static std::size_t DefaultThreadsCount() noexcept {
+				const unsigned int hardware_threads{ std::thread::hardware_concurrency() };
+				return hardware_threads == 0 ? 1 : hardware_threads;
+			}
+
+		private:
+			/** Count of FindTask tries before parking. */
+			static constexpr int kSpinCount{ 32 };
+
+			/** Queues of one priority class of worker. */
+			struct Level {
+				conc::WorkStealingDeque<detail::TaskBase*> deque_{};
+				detail::TaskInbox inbox_{};
+			};
+
+			/** Metrics of worker. Are written only by worker thread, on own cache lines. */
+			struct alignas(conc::kCacheLineSize) WorkerCounters {
+				conc::SingleWriterCounter tasks_executed_{};
+				conc::SingleWriterCounter steals_attempted_{};
+				conc::SingleWriterCounter steals_succeeded_{};
+				conc::SingleWriterCounter parks_{};
+				conc::SingleWriterCounter idle_ns_{};
+				/** Beginning of current search of task, ns. 0 - worker is busy. */
+				conc::SingleWriterCounter idle_since_{};
+				conc::LatencyRecorder queue_latency_{};
+				conc::LatencyRecorder execution_time_{};
+			};
+
+			struct alignas(conc::kCacheLineSize) Worker {
+				explicit Worker(std::size_t index) noexcept : rng_state_{ (index + 1) * 0x9E3779B97F4A7C15ull } {}
+
+				std::array<Level, kPrioritiesCount> levels_{};
+				/** Worker looks for task or sleeps, so tasks of its inbox are left to it. false - executes task. */
+				std::atomic<bool> searching_{ true };
+				/** Is changed on every wake up of this worker. Parked worker waits on it. */
+				alignas(conc::kCacheLineSize) std::atomic<std::uint32_t> wake_epoch_{ 0 };
+				/** Worker sleeps and nobody woke it yet. Waker takes it by exchange, so one wake up wakes one worker. */
+				std::atomic<bool> parked_{ false };
+				/** Written by waking threads, so it is not in counters_ of worker. */
+				std::atomic<std::uint64_t> unparks_{ 0 };
+				std::thread thread_{};
+				/** State of xorshift generator for choosing victim of stealing. */
+				std::uint64_t rng_state_;
+				/** Count of searches of task, for aging of priority classes. */
+				std::uint32_t searches_count_{ 0 };
+				/** CPUs, that worker is pinned to. Empty - not pinned. */
+				std::vector<unsigned int> cpus_{};
+				std::size_t numa_node_{ 0 };
+				WorkerCounters counters_{};
+			};
+
+			struct DeadlineTask {
+				/** Comparator for min-heap: the earliest deadline is on top, equal deadlines in order of submit. */
+				static bool Later(const DeadlineTask& lhs, const DeadlineTask& rhs) noexcept {
+					return lhs.deadline_ != rhs.deadline_ ? lhs.deadline_ > rhs.deadline_ : lhs.sequence_ > rhs.sequence_;
+				}
+
+				Clock::time_point deadline_;
+				std::uint64_t sequence_;
+				detail::TaskBase* task_;
+			};
+
+			template<typename FuncT>
+			static std::unique_ptr<detail::TaskBase> MakeTask(FuncT&& func) {
+				return std::make_unique<detail::Task<std::decay_t<FuncT>>>(std::forward<FuncT>(func));
+			}
+
+			/** Worker i is placed on node i * nodes / workers, so nodes get equal contiguous groups of workers. */
+			void PlaceWorkers(WorkerAffinity affinity, const conc::CpuTopology& topology) {
+				const std::size_t nodes_count{ topology.nodes.size() };
+				std::vector<std::size_t> node_workers(nodes_count, 0);
+				for (std::size_t i = 0; i < workers_.size(); ++i) {
+					const std::size_t node_index{ i * nodes_count / workers_.size() };
+					const conc::NumaNode& node{ topology.nodes[node_index] };
+					Worker& worker{ *workers_[i] };
+					worker.numa_node_ = node.id;
+					if (affinity == WorkerAffinity::kCores) {
+						worker.cpus_.push_back(node.cpus[node_workers[node_index]++ % node.cpus.size()]);
+					} else {
+						worker.cpus_ = node.cpus;
+					}
+				}
+			}
+
+			void WorkerLoop(std::size_t index) {
+				Worker& self{ *workers_[index] };
+				if (!self.cpus_.empty()) { conc::SetCurrentThreadAffinity(self.cpus_); }
+				tls_context_ = detail::WorkerContext{ this, index };
+				WorkerCounters& counters{ self.counters_ };
+				while (true) {
+					detail::TaskBase* task{ FindTask(index) };
+					if (!task && counters.idle_since_.load() == 0) { counters.idle_since_.store(NowNs()); }
+					for (int spin = 0; !task && spin < kSpinCount; ++spin) {
+						conc::CpuRelax();
+						task = FindTask(index);
+					}
+
+					if (task) {
+						if (const std::uint64_t idle_since{ counters.idle_since_.load() }; idle_since != 0) {
+							counters.idle_ns_.add(NowNs() - idle_since);
+							counters.idle_since_.store(0);
+						}
+						self.searching_.store(false, std::memory_order_relaxed);
+						Execute(self, task);
+						self.searching_.store(true, std::memory_order_relaxed);
+					} else if (stop_.load(std::memory_order_acquire) && !HasWork()) {
+						break;
+					} else {
+						Park(self);
+					}
+				}
+				tls_context_ = detail::WorkerContext{}; // stopped worker stays idle in metrics
+			}
+
+			/**
+			* Deadline tasks -> high class -> ... -> low class.
+			* Aging search skips deadline tasks and begins from normal or low class in turn.
+			*/
+			detail::TaskBase* FindTask(std::size_t index) {
+				Worker& self{ *workers_[index] };
+				const std::uint32_t search{ ++self.searches_count_ };
+				if (search % kAgingPeriod == 0) {
+					const std::size_t first_level{ 1 + search / kAgingPeriod % (kPrioritiesCount - 1) };
+					for (std::size_t level = first_level; level < kPrioritiesCount; ++level) {
+						if (detail::TaskBase* task{ FindTask(index, level) }) { return task; }
+					}
+				}
+
+				if (detail::TaskBase* task{ TakeDeadlineTask() }) { return task; }
+				for (std::size_t level = 0; level < kPrioritiesCount; ++level) {
+					if (detail::TaskBase* task{ FindTask(index, level) }) { return task; }
+				}
+				return nullptr;
+			}
+
+			/**
+			* Own deque -> own inbox -> steal from other workers. Only tasks of one priority class.
+			* Inbox of other worker is taken only while it executes task, so task of post_to() runs on its worker,
+			* if the worker is free.
+			*/
+			detail::TaskBase* FindTask(std::size_t index, std::size_t level) {
+				Worker& self{ *workers_[index] };
+				Level& own{ self.levels_[level] };
+				if (detail::TaskBase* task{ own.deque_.pop().value_or(nullptr) }) { return task; }
+				if (detail::TaskBase* task{ TakeInbox(own, own) }) { return task; }
+
+				const std::size_t count{ workers_.size() };
+				const std::size_t start{ static_cast<std::size_t>(NextRandom(self) % count) };
+				for (std::size_t i = 0; i < count; ++i) {
+					const std::size_t victim_index{ (start + i) % count };
+					if (victim_index == index) { continue; }
+					Level& victim{ workers_[victim_index]->levels_[level] };
+					self.counters_.steals_attempted_.add();
+					detail::TaskBase* task{ victim.deque_.steal().value_or(nullptr) };
+					if (!task && CanStealInbox(*workers_[victim_index])) { task = TakeInbox(victim, own); }
+					if (task) {
+						self.counters_.steals_succeeded_.add();
+						return task;
+					}
+				}
+				return nullptr;
+			}
+
+			/** @return		task with the earliest deadline or nullptr. No lock, if there are no such tasks. */
+			detail::TaskBase* TakeDeadlineTask() {
+				if (deadline_tasks_count_.load(std::memory_order_acquire) == 0) { return nullptr; }
+				std::lock_guard<std::mutex> lock{ deadline_mutex_ };
+				if (deadline_tasks_.empty()) { return nullptr; }
+				std::pop_heap(deadline_tasks_.begin(), deadline_tasks_.end(), DeadlineTask::Later);
+				detail::TaskBase* task{ deadline_tasks_.back().task_ };
+				deadline_tasks_.pop_back();
+				deadline_tasks_count_.store(deadline_tasks_.size(), std::memory_order_release);
+				return task;
+			}
+
+			/** Take all tasks of inbox. First task is returned, others are moved to deque of thief. */
+			detail::TaskBase* TakeInbox(Level& victim, Level& thief) {
+				detail::TaskBase* first{ victim.inbox_.TakeAll() };
+				if (!first) { return nullptr; }
+
+				detail::TaskBase* task{ first->next_ };
+				first->next_ = nullptr;
+				if (task) {
+					while (task) {
+						detail::TaskBase* next{ task->next_ };
+						task->next_ = nullptr;
+						thief.deque_.push(task);
+						task = next;
+					}
+					NotifyOne(); // other workers can steal the rest
+				}
+				return first;
+			}
+
+			/** Busy worker can't take own inbox soon. Stopped workers leave inboxes to anybody. */
+			bool CanStealInbox(const Worker& victim) const noexcept {
+				return !victim.searching_.load(std::memory_order_relaxed) || stop_.load(std::memory_order_relaxed);
+			}
+
+			bool HasWork() const noexcept {
+				if (deadline_tasks_count_.load(std::memory_order_acquire) != 0) { return true; }
+				for (const auto& worker : workers_) {
+					for (const Level& level : worker->levels_) {
+						if (!level.deque_.empty() || !level.inbox_.Empty()) { return true; }
+					}
+				}
+				return false;
+			}
+
+			/** Worker pushes to own deque, other threads to inbox of some worker. */
+			void Submit(detail::TaskBase* task, TaskPriority priority) {
+				const auto level{ static_cast<std::size_t>(priority) };
+				Sample(task);
+				if (tls_context_.pool == this) {
+					workers_[tls_context_.index]->levels_[level].deque_.push(task);
+					NotifyOne();
+				} else {
+					const std::size_t index{ NextInboxIndex() };
+					workers_[index]->levels_[level].inbox_.Push(task);
+					NotifyOwner(index);
+				}
+			}
+
+			static void Execute(detail::TaskBase* task) { task->Run(); }
+
+			/** Execute task by worker and count it. Sampled task is timed. */
+			static void Execute(Worker& worker, detail::TaskBase* task) {
+				WorkerCounters& counters{ worker.counters_ };
+				counters.tasks_executed_.add();
+				const std::uint64_t enqueue_time{ task->enqueue_time_ }; // task is freed by Run()
+				if (enqueue_time == 0) {
+					task->Run();
+					return;
+				}
+				const std::uint64_t start{ NowNs() };
+				task->Run();
+				const std::uint64_t end{ NowNs() };
+				counters.queue_latency_.record(start > enqueue_time ? start - enqueue_time : 0);
+				counters.execution_time_.record(end - start);
+			}
+
+			/** Stamp every kLatencySamplePeriod-th task of current thread with time of submit. */
+			static void Sample(detail::TaskBase* task) noexcept {
+				thread_local std::uint32_t submits_count{ 0 };
+				if (++submits_count % kLatencySamplePeriod == 0) { task->enqueue_time_ = NowNs(); }
+			}
+
+			static std::uint64_t NowNs() noexcept {
+				const auto time{ std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()) };
+				return std::max<std::uint64_t>(1, static_cast<std::uint64_t>(time.count())); // 0 is reserved
+			}
+
+			/**
+			* Sleep until some thread notify. Worker announces itself as sleeper and checks queues once more,
+			* so task, that was pushed between last check and sleep, is not lost.
+			* Every worker sleeps on own epoch, so task of inbox wakes its owner, not random worker.
+			*/
+			void Park(Worker& self) {
+				const std::uint32_t epoch{ self.wake_epoch_.load(std::memory_order_acquire) };
+				self.parked_.store(true, std::memory_order_seq_cst);
+				sleepers_.fetch_add(1, std::memory_order_seq_cst);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (!HasWork() && !stop_.load(std::memory_order_acquire)) {
+					self.counters_.parks_.add();
+					self.wake_epoch_.wait(epoch, std::memory_order_acquire);
+				} else {
+					std::this_thread::yield(); // work may be in inbox of other free worker: let it run
+				}
+				self.parked_.store(false, std::memory_order_relaxed);
+				sleepers_.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			/** Wake worker, if it is parked and nobody woke it yet. */
+			bool Wake(Worker& worker) noexcept {
+				if (!worker.parked_.load(std::memory_order_relaxed)
+					|| !worker.parked_.exchange(false, std::memory_order_acq_rel)) {
+					return false;
+				}
+				notifies_.fetch_add(1, std::memory_order_relaxed);
+				worker.unparks_.fetch_add(1, std::memory_order_relaxed);
+				worker.wake_epoch_.fetch_add(1, std::memory_order_release);
+				worker.wake_epoch_.notify_one();
+				return true;
+			}
+
+			/** Wake one parked worker. No system call, if nobody sleeps. */
+			void NotifyOne() noexcept {
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (sleepers_.load(std::memory_order_relaxed) == 0) { return; }
+				thread_local std::size_t cursor{ std::hash<std::thread::id>{}(std::this_thread::get_id()) };
+				const std::size_t start{ cursor++ };
+				for (std::size_t i = 0; i < workers_.size(); ++i) {
+					if (Wake(*workers_[(start + i) % workers_.size()])) { return; }
+				}
+			}
+
+			/**
+			* Task was pushed to inbox of worker. Parked owner is woken. Busy owner leaves task to other worker,
+			* so one of them is woken. Owner, that looks for task, takes it itself.
+			*/
+			void NotifyOwner(std::size_t index) noexcept {
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				Worker& owner{ *workers_[index] };
+				if (Wake(owner)) { return; }
+				if (!owner.searching_.load(std::memory_order_relaxed)) { NotifyOne(); }
+			}
+
+			/** Every external thread has own cursor, so producers don't fight for one atomic counter. */
+			std::size_t NextInboxIndex() const noexcept {
+				thread_local std::size_t cursor{ std::hash<std::thread::id>{}(std::this_thread::get_id()) };
+				return cursor++ % workers_.size();
+			}
+
+			static std::uint64_t NextRandom(Worker& worker) noexcept {
+				std::uint64_t x{ worker.rng_state_ };
+				x ^= x << 13;
+				x ^= x >> 7;
+				x ^= x << 17;
+				worker.rng_state_ = x;
+				return x;
+			}
+
+
+			std::vector<std::unique_ptr<Worker>> workers_{};
+
+			/** Min-heap of tasks with deadline. Such tasks are rare, so one lock is enough. */
+			std::mutex deadline_mutex_{};
+			std::vector<DeadlineTask> deadline_tasks_{};
+			std::uint64_t deadline_sequence_{ 0 };
+			/** Size of heap, that can be read without lock. */
+			alignas(conc::kCacheLineSize) std::atomic<std::size_t> deadline_tasks_count_{ 0 };
+
+			alignas(conc::kCacheLineSize) std::atomic<bool> stop_{ false };
+			/** Count of parked workers: NotifyOne() doesn't look for sleeper, if there is none. */
+			alignas(conc::kCacheLineSize) std::atomic<std::uint32_t> sleepers_{ 0 };
+			/** Is changed only on path with system call. */
+			std::atomic<std::uint64_t> notifies_{ 0 };
+			const std::uint64_t start_time_{ NowNs() };
+
+			static inline thread_local detail::WorkerContext tls_context_{};
+		}; // !class ThreadPool
+
+
+		/**
+		* Pool, that is shared by parallel algorithms of library. Is created on first use.
+		* Count of workers is count of hardware threads.
+		*/
+		inline ThreadPool& DefaultThreadPool() {
+			static ThreadPool pool{};
+			return pool;
+		}
+
 		/*
 		* Container choices:
 		* 1) vector
@@ -115,22 +1287,11 @@ namespace util {
 		* characteristics. A thread pool is usually implemented in such a way that a fixed number of threads are
 		* allocated in advance and stored in a vector.
 		*
-		* It is important to note that inserting and deleting elements from the middle of a vector can cause all
-		* subsequent elements to be moved, which slows down the operation. However, this problem can be solved
-		* by pre-reserving memory (reserve()).
-		*
-		* 2) list, forward_list
-		* If you expect threads to be frequently removed from arbitrary positions in the list (e.g. one thread has
-		* finished its work and is removed from the pool), a doubly linked list (std::list) is a better choice, since
-		* it provides constant time for removing an element across iterators.
-		* Note: Make sure to use mutex protection to safely access the list from different threads.
-		*
-		* 3) deque
-		* A queue allows you to efficiently add and remove items from both the front and back of a queue. It is especially
-		* useful if you need to implement a priority task queue where items can be added and removed asynchronously by
-		* different threads.
+		* 2) deque
+		* Work-stealing deque per worker. Owner works with one end, thieves with another. So contention is only
+		* on the last element.
 		*
-		* 4) Intel TBB (Threaded Building Blocks) Containers for multithread work.
+		* 3) Intel TBB (Threaded Building Blocks) Containers for multithread work.
 		*/
 
 	} // !namespace thread
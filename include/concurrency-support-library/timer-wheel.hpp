@@ -0,0 +1,347 @@
+﻿#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <algorithm>	// max
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>		// size_t
+#include <cstdint>		// uint32_t, uint64_t
+#include <deque>
+#include <functional>	// function
+#include <limits>
+#include <memory>		// shared_ptr, make_shared
+#include <mutex>		// mutex, unique_lock, lock_guard
+#include <thread>
+#include <utility>		// move, exchange
+#include <vector>
+
+#include "concurrency-support-library/thread.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/**
+	* Hierarchical hashed timer wheel (Varghese & Lauck). Callbacks of expired timers are posted to pool.
+	* Time is divided into ticks. Level 0 has slot for every of the next kSlotsCount ticks, every next level has
+	* slot for kSlotsCount ticks of previous level. Timer is put into list of slot, and when time of slot of
+	* upper level comes, its timers are cascaded to lower levels. Schedule and cancel are O(1): link and unlink
+	* of node in list under short lock. Most timers are cancelled before cascading, so they cost nothing more.
+	*
+	* Dedicated tick thread advances wheel. It sleeps until the next occupied slot of level 0 or the next
+	* cascade of occupied slot, so long timeouts don't wake it on every tick. It sleeps, while wheel is empty.
+	* Callback runs not earlier, than its time, and usually not later, than 1 tick after it, if pool is free.
+	* Callback must not throw, like task of ThreadPool::post().
+	* Delays longer, than range of the wheel (kSlotsCount^kLevelsCount ticks), fire at the end of range.
+	*/
+	class TimerWheel {
+	public:
+		using Clock = std::chrono::steady_clock;
+		/** Handle of timer for cancel(). 0 - invalid. */
+		using TimerId = std::uint64_t;
+
+		static constexpr TimerId kInvalidTimer{ 0 };
+		static constexpr std::size_t kSlotsBits{ 8 };
+		static constexpr std::size_t kSlotsCount{ std::size_t{ 1 } << kSlotsBits };
+		static constexpr std::size_t kLevelsCount{ 4 };
+
+		/** @param tick		resolution of timers */
+		explicit TimerWheel(util::thread::ThreadPool& pool = util::thread::DefaultThreadPool(),
+							Clock::duration tick = std::chrono::milliseconds{ 1 })
+			: pool_{ pool }, tick_{ tick > Clock::duration::zero() ? tick : Clock::duration{ 1 } }, start_{ Clock::now() } {
+			for (auto& level : slots_) { level.fill(kNil); }
+			thread_ = std::thread{ [this]() { TickLoop(); } };
+		}
+
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+		TimerWheel(TimerWheel&&) noexcept = delete;
+		TimerWheel& operator=(TimerWheel&&) noexcept = delete;
+
+		/** Stop tick thread. Timers, that didn't expire, are discarded. */
+		~TimerWheel() {
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				stop_ = true;
+			}
+			wake_.notify_one();
+			thread_.join();
+		}
+
+		/** Post callback to pool at time point. */
+		template<typename FuncT>
+		TimerId schedule_at(Clock::time_point time, FuncT&& callback) {
+			return Schedule(TickOf(time), 0, std::function<void()>{ std::forward<FuncT>(callback) });
+		}
+
+		/** Post callback to pool after delay. */
+		template<typename FuncT>
+		TimerId schedule_after(Clock::duration delay, FuncT&& callback) {
+			return schedule_at(Clock::now() + delay, std::forward<FuncT>(callback));
+		}
+
+		/** Post callback to pool every period, the first time after period. Until cancel(). */
+		template<typename FuncT>
+		TimerId schedule_every(Clock::duration period, FuncT&& callback) {
+			const std::uint64_t period_ticks{ std::max<std::uint64_t>(1, Ticks(period)) };
+			auto cancelled{ std::make_shared<std::atomic<bool>>(false) };
+			return Schedule(TickOf(Clock::now() + period), period_ticks,
+							[cancelled, callback = std::function<void()>{ std::forward<FuncT>(callback) }]() {
+								if (!cancelled->load(std::memory_order_acquire)) { callback(); }
+							}, cancelled); // not moved: order of evaluation of arguments is unspecified
+		}
+
+		/**
+		* Remove timer. O(1).
+		* Periodic timer isn't called after cancel(), even if its call was posted to pool already. Call, that
+		* started before cancel(), may still run.
+		*
+		* @return		false, if timer fired already (not periodic) or was cancelled
+		*/
+		bool cancel(TimerId id) noexcept {
+			const std::uint32_t index{ static_cast<std::uint32_t>(id >> 32) };
+			const std::uint32_t generation{ static_cast<std::uint32_t>(id) };
+			std::lock_guard<std::mutex> lock{ mutex_ };
+			if (id == kInvalidTimer || index >= nodes_.size() || nodes_[index].generation_ != generation
+																|| nodes_[index].slot_ == kNil) {
+				return false;
+			}
+			if (nodes_[index].cancelled_) { nodes_[index].cancelled_->store(true, std::memory_order_release); }
+			Unlink(index);
+			Free(index);
+			return true;
+		}
+
+		/** Count of scheduled timers. */
+		std::size_t size() const {
+			std::lock_guard<std::mutex> lock{ mutex_ };
+			return timers_count_;
+		}
+
+	private:
+		static constexpr std::uint32_t kNil{ static_cast<std::uint32_t>(-1) };
+		static constexpr std::uint64_t kSlotMask{ kSlotsCount - 1 };
+		static constexpr std::uint64_t kNever{ std::numeric_limits<std::uint64_t>::max() };
+
+		/** Timer. Nodes are reused by free list, generation tells old handles from new timer. */
+		struct Node {
+			std::function<void()> callback_{};
+			/** Periodic timer: copies of callback, that were posted, check it. */
+			std::shared_ptr<std::atomic<bool>> cancelled_{};
+			std::uint64_t expiry_{ 0 };		// tick
+			std::uint64_t period_{ 0 };		// ticks, 0 - not periodic
+			std::uint32_t previous_{ kNil };
+			std::uint32_t next_{ kNil };	// in slot or in free list
+			std::uint32_t slot_{ kNil };		// level * kSlotsCount + slot. kNil - not in wheel
+			std::uint32_t generation_{ 1 };
+		};
+
+		std::uint64_t Ticks(Clock::duration duration) const noexcept {
+			return duration > Clock::duration::zero()
+				? static_cast<std::uint64_t>((duration + tick_ - Clock::duration{ 1 }) / tick_) : 0; // ceil
+		}
+
+		std::uint64_t TickOf(Clock::time_point time) const noexcept { return Ticks(time - start_); }
+
+		TimerId Schedule(std::uint64_t expiry, std::uint64_t period, std::function<void()>&& callback,
+						std::shared_ptr<std::atomic<bool>> cancelled = {}) {
+			bool wake{ false };
+			TimerId id{ kInvalidTimer };
+			{
+				std::lock_guard<std::mutex> lock{ mutex_ };
+				const std::uint32_t index{ Allocate() };
+				Node& node{ nodes_[index] };
+				node.callback_ = std::move(callback);
+				node.cancelled_ = std::move(cancelled);
+				node.expiry_ = expiry;
+				node.period_ = period;
+				if (timers_count_ == 0) { current_tick_ = std::max(current_tick_, TickOf(Clock::now())); } // skip idle ticks
+				wake = Link(index) < wake_tick_; // tick thread sleeps past the new timer
+				id = (static_cast<TimerId>(index) << 32) | node.generation_;
+			}
+			if (wake) { wake_.notify_one(); }
+			return id;
+		}
+
+		std::uint32_t Allocate() {
+			if (free_ == kNil) {
+				nodes_.emplace_back();
+				return static_cast<std::uint32_t>(nodes_.size() - 1);
+			}
+			const std::uint32_t index{ free_ };
+			free_ = nodes_[index].next_;
+			return index;
+		}
+
+		void Free(std::uint32_t index) noexcept {
+			Node& node{ nodes_[index] };
+			node.callback_ = nullptr;
+			node.cancelled_.reset();
+			if (++node.generation_ == 0) { node.generation_ = 1; } // 0 is reserved for kInvalidTimer
+			node.next_ = free_;
+			free_ = index;
+		}
+
+		/**
+		* Put timer into slot of the lowest level, that covers its delay.
+		*
+		* @return		tick, when slot of timer is processed: expiry on level 0, cascade of slot on upper levels
+		*/
+		std::uint64_t Link(std::uint32_t index) noexcept {
+			Node& node{ nodes_[index] };
+			if (node.expiry_ < current_tick_) { node.expiry_ = current_tick_; }
+			const std::uint64_t delta{ node.expiry_ - current_tick_ };
+			std::size_t level{ 0 };
+			while (level + 1 < kLevelsCount && delta >= (std::uint64_t{ 1 } << (kSlotsBits * (level + 1)))) { ++level; }
+			const std::uint64_t max_delta{ (std::uint64_t{ 1 } << (kSlotsBits * kLevelsCount)) - 1 };
+			if (delta > max_delta) { // beyond range of wheel
+				node.expiry_ = current_tick_ + max_delta;
+			}
+			const std::size_t slot{ static_cast<std::size_t>((node.expiry_ >> (kSlotsBits * level)) & kSlotMask) };
+
+			std::uint32_t& head{ slots_[level][slot] };
+			node.slot_ = static_cast<std::uint32_t>(level * kSlotsCount + slot);
+			node.previous_ = kNil;
+			node.next_ = head;
+			if (head != kNil) { nodes_[head].previous_ = index; }
+			head = index;
+			++timers_count_;
+			const std::size_t level_shift{ kSlotsBits * level };
+			return (node.expiry_ >> level_shift) << level_shift;
+		}
+
+		void Unlink(std::uint32_t index) noexcept {
+			Node& node{ nodes_[index] };
+			if (node.previous_ != kNil) {
+				nodes_[node.previous_].next_ = node.next_;
+			} else {
+				slots_[node.slot_ / kSlotsCount][node.slot_ % kSlotsCount] = node.next_;
+			}
+			if (node.next_ != kNil) { nodes_[node.next_].previous_ = node.previous_; }
+			node.slot_ = kNil;
+			--timers_count_;
+		}
+
+		/** Take list of slot. */
+		std::uint32_t TakeSlot(std::size_t level, std::size_t slot) noexcept {
+			return std::exchange(slots_[level][slot], kNil);
+		}
+
+		/** Slot of some upper level is cascaded at tick. */
+		bool NeedsCascade(std::uint64_t tick) const noexcept {
+			for (std::size_t level = 1; level < kLevelsCount; ++level) {
+				const std::uint64_t level_mask{ (std::uint64_t{ 1 } << (kSlotsBits * level)) - 1 };
+				if ((tick & level_mask) != 0) { return false; } // upper levels aren't aligned too
+				const std::size_t slot{ static_cast<std::size_t>((tick >> (kSlotsBits * level)) & kSlotMask) };
+				if (slots_[level][slot] != kNil) { return true; }
+			}
+			return false;
+		}
+
+		/**
+		* The first tick since current_tick_, that has timers of level 0 or cascade of occupied slot.
+		* Timers of level 0 expire in the next kSlotsCount ticks, so only cascades are checked after them.
+		* Returns tick, that is kSlotsCount^2 ticks ahead at most, so search is short.
+		*/
+		std::uint64_t NextEventTick() const noexcept {
+			std::uint64_t tick{ current_tick_ };
+			for (; tick < current_tick_ + kSlotsCount; ++tick) {
+				if (slots_[0][tick & kSlotMask] != kNil || NeedsCascade(tick)) { return tick; }
+			}
+			tick = (tick + kSlotMask) & ~kSlotMask;
+			for (std::size_t i = 0; i < kSlotsCount; ++i, tick += kSlotsCount) {
+				if (NeedsCascade(tick)) { return tick; }
+			}
+			return tick;
+		}
+
+		/**
+		* Process tick current_tick_: cascade slots of upper levels, whose time came, then collect expired
+		* timers of level 0 slot.
+		*/
+		void ProcessTick(std::vector<std::function<void()>>& expired) {
+			for (std::size_t level = kLevelsCount - 1; level > 0; --level) {
+				const std::uint64_t level_mask{ (std::uint64_t{ 1 } << (kSlotsBits * level)) - 1 };
+				if ((current_tick_ & level_mask) != 0) { continue; }
+				const std::size_t slot{ static_cast<std::size_t>((current_tick_ >> (kSlotsBits * level)) & kSlotMask) };
+				for (std::uint32_t index{ TakeSlot(level, slot) }; index != kNil;) {
+					const std::uint32_t next{ nodes_[index].next_ };
+					--timers_count_;
+					Link(index); // to lower level
+					index = next;
+				}
+			}
+
+			for (std::uint32_t index{ TakeSlot(0, static_cast<std::size_t>(current_tick_ & kSlotMask)) }; index != kNil;) {
+				Node& node{ nodes_[index] };
+				const std::uint32_t next{ node.next_ };
+				--timers_count_;
+				node.slot_ = kNil;
+				if (node.period_ != 0) {
+					expired.push_back(node.callback_);
+					node.expiry_ += node.period_;
+					Link(index);
+				} else {
+					expired.push_back(std::move(node.callback_));
+					Free(index);
+				}
+				index = next;
+			}
+		}
+
+		void TickLoop() {
+			std::vector<std::function<void()>> expired{};
+			std::unique_lock<std::mutex> lock{ mutex_ };
+			while (!stop_) {
+				if (timers_count_ == 0) { // nothing to do. Schedule() skips ticks, that pass while sleeping
+					wake_tick_ = kNever;
+					wake_.wait(lock, [this]() { return stop_ || timers_count_ != 0; });
+					wake_tick_ = 0;
+					continue;
+				}
+				const std::uint64_t next_tick{ NextEventTick() };
+				const Clock::time_point due{ start_ + tick_ * next_tick };
+				if (Clock::now() < due) {
+					wake_tick_ = next_tick;
+					wake_.wait_until(lock, due);
+					wake_tick_ = 0;
+					continue;
+				}
+				current_tick_ = next_tick; // ticks before it have nothing to do
+				ProcessTick(expired);
+				++current_tick_;
+				if (!expired.empty()) {
+					lock.unlock();
+					for (std::function<void()>& callback : expired) { pool_.post(std::move(callback)); }
+					expired.clear();
+					lock.lock();
+				}
+			}
+		}
+
+		util::thread::ThreadPool& pool_;
+		const Clock::duration tick_;
+		const Clock::time_point start_;
+
+		mutable std::mutex mutex_{};
+		std::condition_variable wake_{};
+		bool stop_{ false };
+		/** The first tick, that is not processed. */
+		std::uint64_t current_tick_{ 0 };
+		/** Tick, until which tick thread sleeps. Schedule() wakes it for earlier timer. 0 - it doesn't sleep. */
+		std::uint64_t wake_tick_{ 0 };
+		std::size_t timers_count_{ 0 };
+		/** Heads of lists of timers. */
+		std::array<std::array<std::uint32_t, kSlotsCount>, kLevelsCount> slots_{};
+		/** Deque doesn't move nodes, when grows. */
+		std::deque<Node> nodes_{};
+		std::uint32_t free_{ kNil };
+
+		std::thread thread_{};
+	}; // !class TimerWheel
+
+} // !namespace conc
+
+#endif // !TIMER_WHEEL_HPP
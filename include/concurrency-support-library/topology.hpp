@@ -0,0 +1,165 @@
+﻿#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+#include <algorithm>	// sort, max
+#include <cstddef>		// size_t
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>	// error_code
+#include <thread>
+#include <utility>		// move
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>	// pthread_setaffinity_np
+#include <sched.h>		// cpu_set_t, CPU_SET
+#endif
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/** NUMA node: memory and CPUs, that are close to this memory. */
+	struct NumaNode {
+		std::size_t id{ 0 };
+		std::vector<unsigned int> cpus{};
+	};
+
+	/**
+	* CPUs of machine grouped by NUMA nodes.
+	* On Linux is read from sysfs, that doesn't need any library. Other systems and machines without sysfs
+	* are described as one node with all hardware threads.
+	*/
+	struct CpuTopology {
+		std::vector<NumaNode> nodes{};
+
+		/** Count of all CPUs. */
+		std::size_t cpus_count() const noexcept {
+			std::size_t count{ 0 };
+			for (const NumaNode& node : nodes) { count += node.cpus.size(); }
+			return count;
+		}
+
+		/** Read topology of current machine. Nodes without CPUs (only memory) are skipped. */
+		static CpuTopology Discover(const std::filesystem::path& nodes_directory = "/sys/devices/system/node") {
+			CpuTopology topology{};
+			std::error_code error{};
+			for (std::filesystem::directory_iterator it{ nodes_directory, error }, end{}; !error && it != end;
+																					it.increment(error)) {
+				const std::string name{ it->path().filename().string() };
+				if (name.size() <= 4 || name.compare(0, 4, "node") != 0
+						|| name.find_first_not_of("0123456789", 4) != std::string::npos) {
+					continue;
+				}
+				std::ifstream cpulist{ it->path() / "cpulist" };
+				std::string list{};
+				std::getline(cpulist, list);
+				NumaNode node{ std::stoul(name.substr(4)), ParseCpuList(list) };
+				if (!node.cpus.empty()) { topology.nodes.push_back(std::move(node)); }
+			}
+			std::sort(topology.nodes.begin(), topology.nodes.end(),
+					[](const NumaNode& lhs, const NumaNode& rhs) { return lhs.id < rhs.id; });
+
+			if (topology.nodes.empty()) { // not Linux or no sysfs
+				NumaNode node{};
+				const unsigned int hardware_threads{ std::max(1u, std::thread::hardware_concurrency()) };
+				for (unsigned int cpu = 0; cpu < hardware_threads; ++cpu) { node.cpus.push_back(cpu); }
+				topology.nodes.push_back(std::move(node));
+			}
+			return topology;
+		}
+
+		/**
+		* Parse list of CPUs in format of Linux kernel: "0-3,8-11".
+		* Wrong parts are skipped.
+		*/
+		static std::vector<unsigned int> ParseCpuList(std::string_view list) {
+			std::vector<unsigned int> cpus{};
+			while (!list.empty()) {
+				const std::size_t comma{ list.find(',') };
+				const std::string_view range{ list.substr(0, comma) };
+				list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+				const std::size_t dash{ range.find('-') };
+				unsigned int first{ 0 }, last{ 0 };
+				if (!ParseNumber(range.substr(0, dash), first)) { continue; }
+				last = first;
+				if (dash != std::string_view::npos && !ParseNumber(range.substr(dash + 1), last)) { continue; }
+				for (unsigned int cpu = first; cpu <= last; ++cpu) { cpus.push_back(cpu); }
+			}
+			return cpus;
+		}
+
+	private:
+		static bool ParseNumber(std::string_view text, unsigned int& number) noexcept {
+			while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) { text.remove_suffix(1); }
+			if (text.empty()) { return false; }
+			number = 0;
+			for (char symbol : text) {
+				if (symbol < '0' || symbol > '9') { return false; }
+				number = number * 10 + static_cast<unsigned int>(symbol - '0');
+			}
+			return true;
+		}
+	};
+
+
+	/**
+	* Size of data (or unified) cache of level of the first CPU. Is read from sysfs on Linux.
+	*
+	* @param level				1 - L1, 2 - L2, ...
+	* @param cache_directory	directory with index* subdirectories of caches
+	* @return					size in bytes. 32K for L1, 1M for other levels, if size is unknown
+	*/
+	inline std::size_t DataCacheSize(unsigned int level,
+						const std::filesystem::path& cache_directory = "/sys/devices/system/cpu/cpu0/cache") {
+		std::error_code error{};
+		for (std::filesystem::directory_iterator it{ cache_directory, error }, end{}; !error && it != end;
+																					it.increment(error)) {
+			auto read_line = [&it](const char* name) {
+				std::ifstream file{ it->path() / name };
+				std::string line{};
+				std::getline(file, line);
+				return line;
+			};
+			if (read_line("level") != std::to_string(level) || read_line("type") == "Instruction") { continue; }
+
+			const std::string size{ read_line("size") }; // "48K", "2048K", "32M"
+			std::size_t bytes{ 0 };
+			std::size_t position{ 0 };
+			for (; position < size.size() && size[position] >= '0' && size[position] <= '9'; ++position) {
+				bytes = bytes * 10 + static_cast<std::size_t>(size[position] - '0');
+			}
+			if (position < size.size() && size[position] == 'K') { bytes *= 1024; }
+			if (position < size.size() && size[position] == 'M') { bytes *= 1024 * 1024; }
+			if (bytes != 0) { return bytes; }
+		}
+		return level <= 1 ? 32 * 1024 : 1024 * 1024;
+	}
+
+
+	/**
+	* Allow current thread to run only on cpus.
+	*
+	* @return		false, if system doesn't support affinity or refused
+	*/
+	inline bool SetCurrentThreadAffinity(std::span<const unsigned int> cpus) noexcept {
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (unsigned int cpu : cpus) {
+			if (cpu < CPU_SETSIZE) { CPU_SET(cpu, &set); }
+		}
+		return !cpus.empty() && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		static_cast<void>(cpus);
+		return false;
+#endif
+	}
+
+} // !namespace conc
+
+#endif // !TOPOLOGY_HPP
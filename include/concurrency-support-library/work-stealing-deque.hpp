@@ -0,0 +1,160 @@
+﻿#ifndef WORK_STEALING_DEQUE_HPP
+#define WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <bit>			// bit_ceil
+#include <cstddef>		// size_t
+#include <cstdint>		// int64_t
+#include <memory>		// unique_ptr
+#include <optional>
+#include <type_traits>	// is_trivially_copyable_v
+#include <vector>
+
+#include "concurrency-support-library/hardware.hpp"
+
+
+/** Namespace for parallel, async operations */
+namespace conc {
+
+	/**
+	* Chase-Lev work-stealing deque. Lock-free.
+	* Owner thread pushes and pops at the bottom (LIFO - data of last item is hot in cache).
+	* Thieves steal at the top (FIFO - the oldest items, usually the biggest parts of work).
+	* Circular array grows, when it is full. Old arrays are freed only in destructor, cause thief may still read them.
+	*
+	* https://www.di.ens.fr/~zappa/readings/ppopp13.pdf
+	*
+	* @param T		trivially copyable, usually pointer to task: items are stored in atomics
+	*/
+	template<typename T>
+	class WorkStealingDeque {
+		static_assert(std::is_trivially_copyable_v<T>, "items of WorkStealingDeque must be trivially copyable");
+
+	public:
+		/** @param capacity		initial capacity, is rounded up to power of two */
+		explicit WorkStealingDeque(std::size_t capacity = 256) {
+			arrays_.emplace_back(std::make_unique<Array>(static_cast<std::int64_t>(std::bit_ceil(capacity | 1))));
+			array_.store(arrays_.back().get(), std::memory_order_relaxed);
+		}
+
+		WorkStealingDeque(const WorkStealingDeque&) = delete;
+		WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+		WorkStealingDeque(WorkStealingDeque&&) noexcept = delete;
+		WorkStealingDeque& operator=(WorkStealingDeque&&) noexcept = delete;
+
+		~WorkStealingDeque() = default;
+
+		/** Only owner thread. */
+		void push(T item) {
+			const std::int64_t bottom{ bottom_.load(std::memory_order_relaxed) };
+			const std::int64_t top{ top_.load(std::memory_order_acquire) };
+			Array* array{ array_.load(std::memory_order_relaxed) };
+			if (bottom - top > array->capacity_ - 1) { // full
+				arrays_.emplace_back(array->Grow(bottom, top));
+				array = arrays_.back().get();
+				array_.store(array, std::memory_order_release);
+			}
+			array->Put(bottom, item);
+			bottom_.store(bottom + 1, std::memory_order_release); // publish item to thieves
+		}
+
+		/**
+		* Only owner thread.
+		*
+		* @return		the newest item or nullopt, if deque is empty
+		*/
+		std::optional<T> pop() noexcept {
+			const std::int64_t bottom{ bottom_.load(std::memory_order_relaxed) - 1 };
+			Array* array{ array_.load(std::memory_order_relaxed) };
+			bottom_.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::int64_t top{ top_.load(std::memory_order_relaxed) };
+
+			std::optional<T> item{};
+			if (top <= bottom) { // not empty
+				item = array->Get(bottom);
+				if (top == bottom) { // last element. Race with thieves
+					if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+																	std::memory_order_relaxed)) {
+						item.reset(); // thief was first
+					}
+					bottom_.store(bottom + 1, std::memory_order_relaxed);
+				}
+			} else { // empty
+				bottom_.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return item;
+		}
+
+		/**
+		* Any thread.
+		*
+		* @return		the oldest item or nullopt, if deque is empty or other thread won the race
+		*/
+		std::optional<T> steal() noexcept {
+			std::int64_t top{ top_.load(std::memory_order_acquire) };
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const std::int64_t bottom{ bottom_.load(std::memory_order_acquire) };
+
+			if (top < bottom) { // not empty
+				Array* array{ array_.load(std::memory_order_acquire) };
+				T item{ array->Get(top) };
+				if (top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+																std::memory_order_relaxed)) {
+					return item;
+				}
+			}
+			return std::nullopt;
+		}
+
+		/** Approximate check. Any thread. */
+		bool empty() const noexcept { return size() == 0; }
+
+		/** Approximate count of items. Any thread. */
+		std::size_t size() const noexcept {
+			const std::int64_t bottom{ bottom_.load(std::memory_order_relaxed) };
+			const std::int64_t top{ top_.load(std::memory_order_relaxed) };
+			return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+		}
+
+	private:
+		/** Circular array with power of two capacity. */
+		struct Array {
+			explicit Array(std::int64_t capacity)
+				: capacity_{ capacity },
+				mask_{ capacity - 1 },
+				buffer_{ std::make_unique<std::atomic<T>[]>(static_cast<std::size_t>(capacity)) } {
+			}
+
+			T Get(std::int64_t index) const noexcept {
+				return buffer_[static_cast<std::size_t>(index & mask_)].load(std::memory_order_relaxed);
+			}
+			void Put(std::int64_t index, T item) noexcept {
+				buffer_[static_cast<std::size_t>(index & mask_)].store(item, std::memory_order_relaxed);
+			}
+
+			/** Copy all live elements [top, bottom) to new array of double size. */
+			std::unique_ptr<Array> Grow(std::int64_t bottom, std::int64_t top) const {
+				auto new_array{ std::make_unique<Array>(capacity_ * 2) };
+				for (std::int64_t i = top; i < bottom; ++i) {
+					new_array->Put(i, Get(i));
+				}
+				return new_array;
+			}
+
+			const std::int64_t capacity_;
+			const std::int64_t mask_;
+			std::unique_ptr<std::atomic<T>[]> buffer_;
+		};
+
+		alignas(kCacheLineSize) std::atomic<std::int64_t> top_{ 0 };
+		alignas(kCacheLineSize) std::atomic<std::int64_t> bottom_{ 0 };
+		alignas(kCacheLineSize) std::atomic<Array*> array_{ nullptr };
+
+		/** Current and retired arrays. Changed only by owner. */
+		std::vector<std::unique_ptr<Array>> arrays_{};
+	}; // !class WorkStealingDeque
+
+} // !namespace conc
+
+#endif // !WORK_STEALING_DEQUE_HPP
@@ -2,19 +2,25 @@
 #define GENERIC_CONTAINER_HPP
 
 
-#include <algorithm>	// remove_if
+#include <algorithm>	// remove_if, sort
 #include <execution>	// execution policies
+#include <functional>	// less
+#include <iterator>		// random_access_iterator
 #include <type_traits>	// is_same_v
 #include <utility>		// forward
 
 // Container Types
 #include <forward_list>
+#include <list>				// Sort
 
 #include <set>				// Find
 #include <unordered_set>	// Find
 #include <map>				// Find
 #include <unordered_map>	// Find
 
+#include "concurrency-support-library/parallel-find.hpp"	// parallel_find
+#include "concurrency-support-library/parallel-sort.hpp"	// parallel_sort
+
 // TODO: Too many container types. Too complex
 
 // TODO: add specific functions for that containers, for which solution is not optimal.
@@ -24,6 +30,28 @@
 /** Generic container processing. One function for all container types. */
 namespace generic { // Generic Container Element Modification
 
+	namespace detail {
+		/** set, unordered_set with any comparator, hash and allocator */
+		template<typename ContainerT>
+		struct IsSet : std::false_type {};
+		template<typename KeyT, typename... RestT>
+		struct IsSet<std::set<KeyT, RestT...>> : std::true_type {};
+		template<typename KeyT, typename... RestT>
+		struct IsSet<std::unordered_set<KeyT, RestT...>> : std::true_type {};
+		template<typename ContainerT>
+		inline bool constexpr IsSet_v = IsSet<std::remove_cvref_t<ContainerT>>::value;
+
+		/** map, unordered_map with any comparator, hash and allocator */
+		template<typename ContainerT>
+		struct IsMap : std::false_type {};
+		template<typename KeyT, typename MappedT, typename... RestT>
+		struct IsMap<std::map<KeyT, MappedT, RestT...>> : std::true_type {};
+		template<typename KeyT, typename MappedT, typename... RestT>
+		struct IsMap<std::unordered_map<KeyT, MappedT, RestT...>> : std::true_type {};
+		template<typename ContainerT>
+		inline bool constexpr IsMap_v = IsMap<std::remove_cvref_t<ContainerT>>::value;
+	} // !namespace detail
+
 	/**
 	* Add (emplace, push or insert) element from any type of container.
 	*
@@ -33,24 +61,20 @@ namespace generic { // Generic Container Element Modification
 	*
 	* Mutex: read
 	*/
-	template<typename ContainerT, typename ExecPolicyT>
+	template<typename ContainerT, typename ExecPolicyT = std::execution::sequenced_policy>
 	inline decltype(auto) Find(const ContainerT& container,
 								const typename ContainerT::value_type& value,
 								ExecPolicyT policy = std::execution::seq) {
-		using value_type = typename ContainerT::value_type;
-
-		if constexpr (
-				std::is_same_v<std::remove_cvref_t<ContainerT>, std::unordered_set<value_type>>
-				|| std::is_same_v<std::remove_cvref_t<ContainerT>, std::set<value_type>>
-				|| std::is_same_v<std::remove_cvref_t<ContainerT>, std::unordered_map<value_type>>
-				|| std::is_same_v<std::remove_cvref_t<ContainerT>, std::map<value_type>>
-				//|| std::is_same_v<std::remove_cvref_t<ContainerT>, std::multiset<value_type>>
-				//|| std::is_same_v<std::remove_cvref_t<ContainerT>, std::multimap<value_type>>
-			)
-		{ // associative containers have special find() method
+		if constexpr (detail::IsSet_v<ContainerT>) { // associative containers have special find() method
 			return container.find(value);
-														//unordered_set, unordered_map			O(1)
-														// set, map								O(log n)
+														//unordered_set							O(1)
+														// set									O(log n)
+		}
+		else if constexpr (detail::IsMap_v<ContainerT>) { // value is pair: find by key, then compare mapped value
+			const auto it{ container.find(value.first) };
+			return it != container.end() && it->second == value.second ? it : container.end();
+														//unordered_map							O(1)
+														// map									O(log n)
 		}
 		//else if constexpr (std::is_same_v<std::remove_cvref_t<ContainerT>, std::vector<bool>>) {
 		//	// Специальный случай для vector<bool>. Стандартные алгоритмы работают медленно.
@@ -61,6 +85,11 @@ namespace generic { // Generic Container Element Modification
 		//	return pos != container.size();
 
 		//}
+		else if constexpr ((std::is_same_v<std::remove_cvref_t<ExecPolicyT>, std::execution::parallel_policy>
+							|| std::is_same_v<std::remove_cvref_t<ExecPolicyT>, std::execution::parallel_unsequenced_policy>)
+						&& std::random_access_iterator<decltype(container.begin())>) { // stops all threads at match
+			return conc::parallel_find(container.begin(), container.end(), value);			// O(n / threads)
+		}
 		else { // All other types of containers
 			return std::find(policy, container.begin(), container.end(), value);				// O(n)
 		}
@@ -139,6 +168,37 @@ namespace generic { // Generic Container Element Modification
 		}
 	}
 
+	/**
+	* Sort elements of container.
+	* parallel and parallel_unsequenced policies sort random access containers by conc::parallel_sort()
+	* on DefaultThreadPool(): standard parallel algorithms of libstdc++ are sequential without TBB.
+	* list and forward_list are sorted by own sort(), that relinks nodes.
+	*
+	* Complexity: O(n log n), parallel - O(n log n / threads)
+	* Mutex: write
+	*
+	* @param compare		strict weak ordering of elements
+	*/
+	template<typename ContainerT, typename ExecPolicyT = std::execution::sequenced_policy,
+			typename CompareT = std::less<>>
+	inline void Sort(ContainerT& container,
+					ExecPolicyT policy = std::execution::seq,
+					CompareT compare = {}) {
+		using value_type = typename ContainerT::value_type;
+		using policy_type = std::remove_cvref_t<ExecPolicyT>;
+
+		if constexpr (std::is_same_v<std::remove_cvref_t<ContainerT>, std::forward_list<value_type>>
+					|| std::is_same_v<std::remove_cvref_t<ContainerT>, std::list<value_type>>) {
+			container.sort(compare);											// O(n log n)
+		} else if constexpr (std::is_same_v<policy_type, std::execution::parallel_policy>
+							|| std::is_same_v<policy_type, std::execution::parallel_unsequenced_policy>) {
+			conc::parallel_sort(container.begin(), container.end(), compare);	// O(n log n / threads)
+		} else { // seq, unseq
+			static_cast<void>(policy);
+			std::sort(container.begin(), container.end(), compare);			// O(n log n)
+		}
+	}
+
 	/**
 	* Remove element of container by iterator.
 	* All types of containers.
@@ -4,6 +4,7 @@
 
 #include <algorithm> // remove_if
 #include <execution> // execution policies
+#include <iterator> // random_access_iterator
 #include <memory>
 #include <type_traits> // is_same_v
 #include <tuple> // tie
@@ -13,6 +14,7 @@
 #include <forward_list>
 #include <set>
 
+#include "concurrency-support-library/parallel-find.hpp"
 #include "containers-library/generic-container.hpp"
 
 
@@ -152,11 +154,16 @@ namespace util {
 		auto searched_shared = searched_ptr.lock();
 		if (!searched_shared) { return end; }
 
-		return std::find_if(policy, container.begin(), end,
-			[&searched_shared](const auto& current_ptr) {
-				return EqualOwnerFn(searched_shared, current_ptr);			// O(1)
-			}
-		); // lambda
+		auto equal_owner = [&searched_shared](const auto& current_ptr) {
+			return EqualOwnerFn(searched_shared, current_ptr);				// O(1)
+		};
+		if constexpr ((std::is_same_v<std::remove_cvref_t<ExecPolicyT>, std::execution::parallel_policy>
+						|| std::is_same_v<std::remove_cvref_t<ExecPolicyT>, std::execution::parallel_unsequenced_policy>)
+					&& std::random_access_iterator<decltype(end)>) { // other threads stop at the first match
+			return conc::parallel_find_if(container.begin(), end, equal_owner);
+		} else {
+			return std::find_if(policy, container.begin(), end, equal_owner);
+		}
 	}
 
 	/**
@@ -0,0 +1,1403 @@
+﻿#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <forward_list>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <latch>
+#include <list>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "concurrency-support-library/blocked-range.hpp"
+#include "concurrency-support-library/combinable.hpp"
+#include "concurrency-support-library/coroutine-task.hpp"
+#include "concurrency-support-library/future.hpp"
+#include "concurrency-support-library/memory-reclamation.hpp"
+#include "concurrency-support-library/metrics.hpp"
+#include "concurrency-support-library/multithreading.hpp"
+#include "concurrency-support-library/parallel-find.hpp"
+#include "concurrency-support-library/parallel-region.hpp"
+#include "concurrency-support-library/parallel-scan.hpp"
+#include "concurrency-support-library/parallel-sort.hpp"
+#include "concurrency-support-library/slot-allocator.hpp"
+#include "concurrency-support-library/spsc-queue.hpp"
+#include "concurrency-support-library/task-group.hpp"
+#include "concurrency-support-library/thread.hpp"
+#include "concurrency-support-library/timer-wheel.hpp"
+#include "concurrency-support-library/topology.hpp"
+#include "concurrency-support-library/work-stealing-deque.hpp"
+#include "containers-library/generic-container.hpp"
+#include "memory-management-library/weak-ptr/weak-ptr.hpp"
+
+
+namespace {
+
+	namespace util {
+
+		namespace thread {
+			using namespace ::util::thread;
+
+//================ThreadPool==============================================================
+
+			TEST(ThreadPoolTest, EnqueueReturnsResult) {
+				ThreadPool pool{ 4 };
+				auto result{ pool.enqueue([](int a, int b) { return a + b; }, 2, 3) };
+				EXPECT_EQ(result.get(), 5);
+			}
+
+			TEST(ThreadPoolTest, AllTasksExecuted) {
+				ThreadPool pool{ 4 };
+				std::atomic<int> counter{ 0 };
+				std::vector<std::future<void>> results{};
+				for (int i = 0; i < 10000; ++i) {
+					results.emplace_back(pool.enqueue([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); }));
+				}
+				for (auto& result : results) { result.get(); }
+				EXPECT_EQ(counter.load(), 10000);
+			}
+
+			TEST(ThreadPoolTest, WorkerSubmitsToOwnDeque) {
+				ThreadPool pool{ 4 };
+				std::atomic<int> counter{ 0 };
+				pool.enqueue([&pool, &counter]() {
+					EXPECT_NE(pool.current_worker_index(), ThreadPool::kNotWorker);
+					for (int i = 0; i < 1000; ++i) {
+						pool.post([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+					}
+				}).get();
+				pool.shutdown();
+				EXPECT_EQ(counter.load(), 1000);
+				EXPECT_EQ(pool.current_worker_index(), ThreadPool::kNotWorker);
+			}
+
+			TEST(ThreadPoolTest, ExceptionIsStoredInFuture) {
+				ThreadPool pool{ 2 };
+				auto result{ pool.enqueue([]() -> int { throw std::runtime_error{ "task error" }; }) };
+				EXPECT_THROW(result.get(), std::runtime_error);
+			}
+
+			TEST(ThreadPoolTest, UrgentTasksSkipAhead) {
+				ThreadPool pool{ 1 };
+				std::promise<void> gate{};
+				pool.post([future = gate.get_future().share()]() { future.wait(); }); // worker is busy
+				std::vector<int> order{}; // only worker writes
+				for (int i = 0; i < 20; ++i) { pool.post(TaskPriority::kLow, [&order]() { order.push_back(0); }); }
+				for (int i = 0; i < 20; ++i) { pool.post(TaskPriority::kHigh, [&order]() { order.push_back(1); }); }
+				const auto now{ ThreadPool::Clock::now() };
+				for (int i : { 3, 1, 2 }) {
+					pool.post(now + std::chrono::seconds{ i }, [&order, i]() { order.push_back(10 + i); });
+				}
+				gate.set_value();
+				pool.shutdown();
+
+				ASSERT_EQ(order.size(), 43);
+				std::vector<int> deadlines{};
+				std::copy_if(order.begin(), order.end(), std::back_inserter(deadlines), [](int x) { return x >= 10; });
+				EXPECT_EQ(deadlines, (std::vector<int>{ 11, 12, 13 }));
+				EXPECT_GE(std::count(order.begin(), order.begin() + 23, 1), 16); // aging lets only few low tasks in
+			}
+
+			TEST(ThreadPoolTest, StarvationOfLowPriorityIsBounded) {
+				ThreadPool pool{ 1 };
+				std::atomic<bool> low_done{ false };
+				int high_count{ 0 };
+				std::function<void()> high_task{};
+				high_task = [&]() {
+					if (!low_done.load() && ++high_count < 10000) { pool.post(TaskPriority::kHigh, high_task); }
+				};
+				pool.post(TaskPriority::kHigh, high_task);
+				pool.post(TaskPriority::kLow, [&low_done]() { low_done.store(true); });
+				pool.shutdown();
+				EXPECT_TRUE(low_done.load());
+				EXPECT_LT(high_count, 100);
+			}
+
+			TEST(ThreadPoolTest, PinnedWorkersExecuteTasks) {
+				const conc::CpuTopology topology{ conc::CpuTopology::Discover() };
+				for (WorkerAffinity affinity : { WorkerAffinity::kCores, WorkerAffinity::kNumaNodes }) {
+					ThreadPool pool{ 3, affinity };
+					std::atomic<int> counter{ 0 };
+					for (int i = 0; i < 100; ++i) { pool.post([&counter]() { counter.fetch_add(1); }); }
+					pool.shutdown();
+					EXPECT_EQ(counter.load(), 100);
+					for (std::size_t i = 0; i < pool.size(); ++i) {
+						EXPECT_TRUE(std::any_of(topology.nodes.begin(), topology.nodes.end(),
+							[&pool, i](const conc::NumaNode& node) { return node.id == pool.numa_node(i); }));
+					}
+				}
+			}
+
+			TEST(ThreadPoolTest, SubmitReturnsTaskFuture) {
+				ThreadPool pool{ 4 };
+				TaskFuture<int> sum{ pool.submit([](int a, int b) { return a + b; }, 2, 3) };
+				EXPECT_EQ(sum.get(), 5);
+				EXPECT_FALSE(sum.valid());
+
+				std::atomic<int> counter{ 0 };
+				TaskFuture<void> done{ pool.submit([&counter]() { counter.fetch_add(1); }) };
+				done.wait();
+				EXPECT_TRUE(done.is_ready());
+				EXPECT_EQ(counter.load(), 1);
+
+				std::array<long long, 64> big{}; // doesn't fit slot
+				big.back() = 7;
+				EXPECT_EQ(pool.submit([big]() { return big.back(); }).get(), 7);
+
+				TaskFuture<int> failed{ pool.submit([]() -> int { throw std::runtime_error{ "task error" }; }) };
+				EXPECT_THROW(failed.get(), std::runtime_error);
+			}
+
+			TEST(ThreadPoolTest, MetricsCountTasks) {
+				ThreadPool pool{ 2 };
+				constexpr int kTasks{ 1000 };
+				for (int i = 0; i < kTasks; ++i) { pool.post([]() {}); }
+				pool.post_to(1, []() {});
+				pool.shutdown();
+
+				const ThreadPoolMetrics metrics{ pool.metrics() };
+				ASSERT_EQ(metrics.workers.size(), 2);
+				const WorkerMetrics total{ metrics.total() };
+				EXPECT_LE(total.tasks_executed, kTasks + 1); // the rest is executed by shutdown()
+				EXPECT_LE(total.steals_succeeded, total.steals_attempted);
+				EXPECT_LE(metrics.queue_latency.count(), (kTasks + 1) / ThreadPool::kLatencySamplePeriod + 1);
+				EXPECT_EQ(metrics.queue_latency.count(), metrics.execution_time.count());
+
+				ThreadPool busy_pool{ 1 };
+				std::atomic<int> counter{ 0 };
+				for (int i = 0; i < kTasks; ++i) {
+					busy_pool.submit([&counter]() { counter.fetch_add(1); }).get(); // every task is executed by worker
+				}
+				const ThreadPoolMetrics busy_metrics{ busy_pool.metrics() };
+				EXPECT_EQ(busy_metrics.workers[0].tasks_executed, kTasks);
+				EXPECT_NEAR(static_cast<double>(busy_metrics.queue_latency.count()),
+							static_cast<double>(kTasks / ThreadPool::kLatencySamplePeriod), 1.0);
+			}
+
+			TEST(ThreadPoolTest, MetricsMeasureIdleTime) {
+				ThreadPool pool{ 1 };
+				std::promise<void> release{};
+				std::latch started{ 1 };
+				TaskFuture<void> long_task{ pool.submit([&started, opened = release.get_future().share()]() {
+					started.count_down();
+					opened.wait();
+				}) };
+				started.wait();
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+				const ThreadPoolMetrics running{ pool.metrics() };
+				EXPECT_LT(running.workers[0].idle_time, running.uptime / 2);
+				EXPECT_GE(running.workers[0].busy_time, std::chrono::milliseconds{ 50 });
+
+				release.set_value();
+				long_task.get();
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+				const ThreadPoolMetrics idle{ pool.metrics() };
+				EXPECT_GE(idle.workers[0].idle_time - running.workers[0].idle_time, std::chrono::milliseconds{ 25 });
+				EXPECT_GT(idle.workers[0].parks, running.workers[0].parks);
+			}
+
+			TEST(ThreadPoolTest, MetricsShowQueueDepthAndUnparks) {
+				ThreadPool pool{ 1 };
+				std::promise<void> release{};
+				std::latch started{ 1 };
+				TaskFuture<void> long_task{ pool.submit([&started, opened = release.get_future().share()]() {
+					started.count_down();
+					opened.wait();
+				}) };
+				started.wait();
+				constexpr std::size_t kQueued{ 5 };
+				std::vector<TaskFuture<void>> queued{};
+				for (std::size_t i = 0; i < kQueued; ++i) { queued.push_back(pool.submit([]() {})); }
+				EXPECT_EQ(pool.metrics().total().queue_depth, kQueued);
+
+				release.set_value();
+				long_task.get();
+				for (TaskFuture<void>& future : queued) { future.get(); }
+				EXPECT_EQ(pool.metrics().total().queue_depth, 0);
+
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+				const ThreadPoolMetrics idle{ pool.metrics() };
+				pool.submit([]() {}).get();
+				const ThreadPoolMetrics woken{ pool.metrics() };
+				EXPECT_GT(woken.workers[0].unparks, idle.workers[0].unparks);
+				EXPECT_EQ(woken.notifies, woken.total().unparks);
+			}
+
+//================TasksQueue==============================================================
+
+			TEST(TasksQueueTest, TryPushFailsWhenFull) {
+				TasksQueue<std::string> queue{ 3 };
+				EXPECT_EQ(queue.capacity(), 4);
+				for (int i = 0; i < 4; ++i) { EXPECT_TRUE(queue.try_push(std::to_string(i))); }
+				std::string rest{ "rest" };
+				EXPECT_FALSE(queue.try_push(std::move(rest)));
+				EXPECT_EQ(rest, "rest"); // value is not moved, if queue is full
+				EXPECT_EQ(queue.size(), 4);
+
+				for (int i = 0; i < 4; ++i) { EXPECT_EQ(queue.try_pop(), std::to_string(i)); }
+				EXPECT_FALSE(queue.try_pop().has_value());
+				EXPECT_TRUE(queue.empty());
+			}
+
+			TEST(TasksQueueTest, ManyProducersManyConsumers) {
+				constexpr int kThreads{ 4 };
+				constexpr long long kValues{ 20000 };
+				TasksQueue<long long> queue{ 64 };
+				std::atomic<long long> sum{ 0 };
+				std::vector<std::thread> threads{};
+				for (int t = 0; t < kThreads; ++t) {
+					threads.emplace_back([&queue, t]() {
+						for (long long i = 0; i < kValues; ++i) { queue.push(i * kThreads + t); }
+					});
+					threads.emplace_back([&queue, &sum]() {
+						long long local_sum{ 0 };
+						for (long long i = 0; i < kValues; ++i) { local_sum += queue.pop(); }
+						sum.fetch_add(local_sum);
+					});
+				}
+				for (auto& thread : threads) { thread.join(); }
+				const long long count{ kValues * kThreads };
+				EXPECT_EQ(sum.load(), count * (count - 1) / 2);
+				EXPECT_TRUE(queue.empty());
+			}
+
+			TEST(TasksQueueTest, QueueOfTasks) {
+				TasksQueue<std::function<void()>> queue{ 2 };
+				int counter{ 0 };
+				std::thread consumer{ [&queue]() {
+					for (int i = 0; i < 100; ++i) { queue.pop()(); }
+				} };
+				for (int i = 0; i < 100; ++i) { queue.push([&counter]() { ++counter; }); }
+				consumer.join();
+				EXPECT_EQ(counter, 100);
+			}
+
+		} // !namespace thread
+
+	} // !namespace util
+
+
+	namespace conc {
+		using namespace ::conc;
+
+//================for_parallel============================================================
+
+		TEST(ForParallelTest, AllIterationsExecutedOnce) {
+			std::vector<int> marks(1000, 0);
+			std::function<void(int, int)> loop{ [&marks](int i, int imax) {
+				for (; i < imax; ++i) { ++marks[static_cast<std::size_t>(i)]; }
+			} };
+			for_parallel(loop, 0, 1000);
+			for (int mark : marks) { EXPECT_EQ(mark, 1); }
+		}
+
+		TEST(ForParallelTest, ExceptionIsRethrown) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::function<void(int, int)> loop{ [](int i, int imax) {
+				for (; i < imax; ++i) {
+					if (i == 77) { throw std::runtime_error{ "loop error" }; }
+				}
+			} };
+			EXPECT_THROW(for_parallel(pool, loop, 0, 100), std::runtime_error);
+		}
+
+		TEST(ForParallelTest, NestedLoopInWorker) {
+			::util::thread::ThreadPool pool{ 2 };
+			std::atomic<int> counter{ 0 };
+			std::function<void(int, int)> loop{ [&counter](int i, int imax) {
+				counter.fetch_add(imax - i, std::memory_order_relaxed);
+			} };
+			pool.enqueue([&pool, &loop]() { for_parallel(pool, loop, 0, 500); }).get();
+			EXPECT_EQ(counter.load(), 500);
+		}
+
+		TEST(ForParallelTest, ParticipantsRunOnTheirWorkers) {
+			::util::thread::ThreadPool pool{ 4 };
+			for (int round = 0; round < 20; ++round) {
+				std::this_thread::sleep_for(std::chrono::milliseconds{ 1 }); // workers are free
+				std::array<std::size_t, 4> workers{};
+				for_parallel(pool, Schedule::Static(), [&pool, &workers](std::size_t i, std::size_t imax) {
+					for (; i < imax; ++i) { workers[i] = pool.current_worker_index(); }
+				}, std::size_t{ 0 }, workers.size());
+				EXPECT_EQ(workers[0], ::util::thread::ThreadPool::kNotWorker); // caller
+				for (std::size_t participant = 1; participant < workers.size(); ++participant) {
+					EXPECT_EQ(workers[participant], participant - 1);
+				}
+			}
+		}
+
+		TEST(ForParallelTest, AllSchedulesCoverRangeOnce) {
+			::util::thread::ThreadPool pool{ 4 };
+			for (Schedule schedule : { Schedule::Static(), Schedule::Static(7), Schedule::Dynamic(),
+										Schedule::Dynamic(3), Schedule::Guided(), Schedule::Guided(5), Schedule::Auto() }) {
+				std::vector<std::atomic<int>> marks(1001);
+				std::function<void(int, int)> loop{ [&marks](int i, int imax) {
+					for (; i < imax; ++i) { marks[static_cast<std::size_t>(i + 10)].fetch_add(1); }
+				} };
+				for_parallel(pool, schedule, loop, -10, 991);
+				for (const auto& mark : marks) { EXPECT_EQ(mark.load(), 1); }
+			}
+		}
+
+		TEST(ForParallelTest, AutoGrainIsCachedPerCallSite) {
+			::util::thread::ThreadPool pool{ 2 };
+			const auto sum_loop{ [&pool]() { // one call site
+				const Schedule schedule{ Schedule::Auto() };
+				std::atomic<long long> sum{ 0 };
+				for_parallel(pool, schedule, [&sum](int i, int imax) {
+					long long local_sum{ 0 };
+					for (; i < imax; ++i) { local_sum += i; }
+					sum.fetch_add(local_sum, std::memory_order_relaxed);
+				}, 0, 1'000'000);
+				EXPECT_EQ(sum.load(), 1'000'000LL * 999'999 / 2);
+				return schedule.tuning;
+			} };
+			detail::AutoTuning* tuning{ sum_loop() };
+			ASSERT_NE(tuning, nullptr);
+			EXPECT_GT(tuning->grain.load(), 1); // cheap iterations need big chunks
+			EXPECT_EQ(sum_loop(), tuning);
+			EXPECT_NE(Schedule::Auto().tuning, tuning);
+
+			detail::RangeScheduler<int> scheduler{ 0, 1000, 4, Schedule::Auto() };
+			std::size_t round{ 0 };
+			int begin{ 0 };
+			int end{ 0 };
+			int covered{ 0 };
+			while (scheduler.Next(0, round, begin, end)) {
+				EXPECT_LE(end - begin, 1000 / (4 * 4)); // every participant gets several chunks
+				covered += end - begin;
+			}
+			EXPECT_EQ(covered, 1000);
+		}
+
+		TEST(ForParallelTest, GuidedChunksShrink) {
+			detail::RangeScheduler<int> scheduler{ 0, 1000, 4, Schedule::Guided(10) };
+			std::size_t round{ 0 };
+			int begin{ 0 };
+			int end{ 0 };
+			int previous_len{ 1000 };
+			while (scheduler.Next(0, round, begin, end)) {
+				EXPECT_LE(end - begin, previous_len);
+				previous_len = end - begin;
+			}
+			EXPECT_EQ(end, 1000);
+		}
+
+		TEST(ForParallelTest, LambdaWith64BitRange) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::atomic<long long> iterations{ 0 };
+			constexpr long long kEnd{ 5'000'000'000LL }; // more than 4G
+			for_parallel(pool, Schedule::Dynamic(1'000'000'000), [&iterations](long long i, long long imax) {
+				iterations.fetch_add(imax - i, std::memory_order_relaxed);
+			}, 0, kEnd);
+			EXPECT_EQ(iterations.load(), kEnd);
+		}
+
+		TEST(ForParallelTest, SignedRangeWiderThanIndexHalf) {
+			detail::RangeScheduler<int> scheduler{ -2'000'000'000, 2'000'000'000, 2, Schedule::Static() };
+			std::size_t round{ 0 };
+			int begin{ 0 };
+			int end{ 0 };
+			ASSERT_TRUE(scheduler.Next(0, round, begin, end));
+			EXPECT_EQ(begin, -2'000'000'000);
+			EXPECT_EQ(end, 0);
+			round = 0;
+			ASSERT_TRUE(scheduler.Next(1, round, begin, end));
+			EXPECT_EQ(begin, 0);
+			EXPECT_EQ(end, 2'000'000'000);
+		}
+
+//================parallel_reduce=========================================================
+
+		TEST(ParallelReduceTest, SumOfRange) {
+			::util::thread::ThreadPool pool{ 4 };
+			for (Schedule schedule : { Schedule::Static(), Schedule::Dynamic(10), Schedule::Guided() }) {
+				const long long sum{ parallel_reduce(pool, schedule, 0, 100'000, 0LL,
+					[](int i, int imax, long long accumulator) {
+						for (; i < imax; ++i) { accumulator += i; }
+						return accumulator;
+					},
+					[](long long lhs, long long rhs) { return lhs + rhs; }) };
+				EXPECT_EQ(sum, 100'000LL * 99'999 / 2);
+			}
+		}
+
+		TEST(ParallelReduceTest, TransformReduceMax) {
+			std::vector<int> values(1000);
+			for (std::size_t i = 0; i < values.size(); ++i) { values[i] = static_cast<int>((i * 7919) % 1000); }
+			const int max_value{ parallel_transform_reduce(std::size_t{ 0 }, values.size(), -1,
+				[](int lhs, int rhs) { return std::max(lhs, rhs); },
+				[&values](std::size_t i) { return values[i]; }) };
+			EXPECT_EQ(max_value, 999);
+		}
+
+		TEST(ParallelReduceTest, EmptyRangeReturnsIdentity) {
+			const int result{ parallel_reduce(5, 5, 42, [](int, int, int accumulator) { return accumulator + 1; },
+												[](int lhs, int rhs) { return lhs + rhs; }) };
+			EXPECT_EQ(result, 42);
+		}
+
+//================parallel_scan===========================================================
+
+		TEST(ParallelScanTest, InclusiveScanEqualsStd) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::vector<long long> values(100'003);
+			for (std::size_t i = 0; i < values.size(); ++i) { values[i] = static_cast<long long>(i % 13) - 6; }
+			std::vector<long long> expected(values.size());
+			std::inclusive_scan(values.begin(), values.end(), expected.begin());
+
+			std::vector<long long> result(values.size());
+			parallel_inclusive_scan(pool, values.begin(), values.end(), result.begin());
+			EXPECT_EQ(result, expected);
+
+			parallel_inclusive_scan(pool, values.begin(), values.end(), values.begin()); // in place
+			EXPECT_EQ(values, expected);
+		}
+
+		TEST(ParallelScanTest, ExclusiveScanEqualsStd) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::vector<int> counts(70'001, 3);
+			std::vector<long long> expected(counts.size());
+			std::exclusive_scan(counts.begin(), counts.end(), expected.begin(), 10LL);
+
+			std::vector<long long> offsets(counts.size());
+			auto offsets_end{ parallel_exclusive_scan(pool, counts.begin(), counts.end(), offsets.begin(), 10LL) };
+			EXPECT_EQ(offsets_end, offsets.end());
+			EXPECT_EQ(offsets, expected);
+		}
+
+//================parallel_find_if========================================================
+
+		TEST(ParallelFindTest, ReturnsFirstMatch) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::vector<int> values(1'000'000, 0);
+			for (std::size_t i = 300'000; i < values.size(); i += 1000) { values[i] = 1; }
+			values[700'001] = 1;
+			std::atomic<std::size_t> checked{ 0 };
+			const auto found{ parallel_find_if(pool, values.begin(), values.end(), [&checked](int value) {
+				checked.fetch_add(1, std::memory_order_relaxed);
+				return value == 1;
+			}) };
+			EXPECT_EQ(found - values.begin(), 300'000);
+			EXPECT_LT(checked.load(), values.size()); // other threads stopped
+
+			EXPECT_EQ(parallel_find(pool, values.begin(), values.end(), 2), values.end());
+			EXPECT_TRUE(parallel_any_of(pool, values.begin(), values.end(), [](int value) { return value == 1; }));
+			EXPECT_FALSE(parallel_any_of(pool, values.begin(), values.begin() + 100, [](int value) { return value == 1; }));
+		}
+
+		TEST(ParallelFindTest, StopTokenCancelsSearch) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::vector<int> values(1'000'000, 0);
+			values.back() = 1;
+			std::stop_source stop{};
+			std::atomic<std::size_t> checked{ 0 };
+			const auto found{ parallel_find_if(pool, values.begin(), values.end(), [&checked, &stop](int value) {
+				if (checked.fetch_add(1, std::memory_order_relaxed) == 10'000) { stop.request_stop(); }
+				return value == 1;
+			}, stop.get_token()) };
+			EXPECT_EQ(found, values.end());
+			EXPECT_LT(checked.load(), values.size());
+		}
+
+		TEST(ParallelFindTest, PoolSkipsCancelledTasks) {
+			::util::thread::ThreadPool pool{ 2 };
+			std::stop_source stop{};
+			std::atomic<int> executed{ 0 };
+			std::promise<void> started{};
+			std::promise<void> finished{};
+			pool.post(stop.get_token(), [&](std::stop_token token) {
+				started.set_value();
+				while (!token.stop_requested()) { std::this_thread::yield(); } // long work checks token
+				executed.fetch_add(1);
+				finished.set_value();
+			});
+			started.get_future().wait();
+			stop.request_stop();
+			finished.get_future().wait();
+			pool.post(stop.get_token(), [&executed]() { executed.fetch_add(100); }); // skipped
+			pool.enqueue([]() {}).get();
+			pool.enqueue([]() {}).get();
+			EXPECT_EQ(executed.load(), 1);
+		}
+
+//================parallel_region=========================================================
+
+		TEST(ParallelRegionTest, IterationsShareWorkers) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::vector<long long> values(1000, 0);
+			std::atomic<int> participants{ 0 };
+			int iterations{ 0 };
+			bool converged{ false };
+			parallel_region(pool, [&](region& team) {
+				participants.fetch_add(1);
+				while (!converged) {
+					team.for_parallel([&values](std::size_t i, std::size_t imax) {
+						for (; i < imax; ++i) { values[i] += static_cast<long long>(i); }
+					}, std::size_t{ 0 }, values.size());
+					team.single([&]() { converged = ++iterations == 500; }); // result of previous loop is visible
+				}
+			});
+			EXPECT_EQ(participants.load(), 4);
+			EXPECT_EQ(iterations, 500);
+			for (std::size_t i = 0; i < values.size(); ++i) { EXPECT_EQ(values[i], static_cast<long long>(i) * 500); }
+		}
+
+		TEST(ParallelRegionTest, ExceptionCancelsRegion) {
+			::util::thread::ThreadPool pool{ 3 };
+			std::atomic<int> iterations{ 0 };
+			EXPECT_THROW(parallel_region(pool, [&iterations](region& team) {
+				for (int i = 0; i < 1000; ++i) {
+					if (i == 10 && team.participant() == team.participants_count() - 1) {
+						throw std::runtime_error{ "participant" };
+					}
+					iterations.fetch_add(1);
+					team.barrier();
+				}
+			}), std::runtime_error);
+			EXPECT_LE(iterations.load(), 11 * 3);
+
+			int sum{ 0 }; // pool is usable after exception
+			parallel_region(pool, [&sum](region& team) { team.single([&sum]() { sum = 1; }); });
+			EXPECT_EQ(sum, 1);
+		}
+
+		TEST(ParallelRegionTest, ConcurrentRegionsDontDeadlock) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::atomic<int> participants{ 0 };
+			for (int i = 0; i < 100; ++i) {
+				std::latch started{ 2 }; // both regions start together and would split workers between them
+				auto run_region = [&pool, &participants, &started]() {
+					started.arrive_and_wait();
+					parallel_region(pool, [&participants](region& team) {
+						participants.fetch_add(1);
+						team.barrier();
+					});
+				};
+				auto first = pool.enqueue(run_region);
+				auto second = pool.enqueue(run_region);
+				first.get();
+				second.get();
+			}
+			EXPECT_EQ(participants.load(), 2 * 100 * 4);
+		}
+
+//================parallel_sort===========================================================
+
+		TEST(ParallelSortTest, SortsLikeStd) {
+			::util::thread::ThreadPool pool{ 4 };
+			for (std::size_t size : { std::size_t{ 0 }, std::size_t{ 1000 }, std::size_t{ 200'003 } }) {
+				std::vector<int> values(size);
+				for (std::size_t i = 0; i < size; ++i) { values[i] = static_cast<int>((i * 7919) % 1009); } // duplicates
+				std::vector<int> expected{ values };
+				std::sort(expected.begin(), expected.end(), std::greater<>{});
+				parallel_sort(pool, values.begin(), values.end(), std::greater<>{});
+				EXPECT_EQ(values, expected);
+			}
+		}
+
+		TEST(ParallelSortTest, MovesOnlyElements) {
+			::util::thread::ThreadPool pool{ 3 };
+			std::vector<std::unique_ptr<int>> values{};
+			for (int i = 0; i < 100'000; ++i) { values.push_back(std::make_unique<int>((i * 7919) % 100'003)); }
+			parallel_sort(pool, values.begin(), values.end(),
+						[](const std::unique_ptr<int>& lhs, const std::unique_ptr<int>& rhs) { return *lhs < *rhs; });
+			EXPECT_TRUE(std::is_sorted(values.begin(), values.end(),
+						[](const std::unique_ptr<int>& lhs, const std::unique_ptr<int>& rhs) { return *lhs < *rhs; }));
+			EXPECT_TRUE(std::all_of(values.begin(), values.end(),
+									[](const std::unique_ptr<int>& value) { return value != nullptr; }));
+		}
+
+//================parallel_for============================================================
+
+		TEST(ParallelForTest, TilesCover2dRangeOnce) {
+			::util::thread::ThreadPool pool{ 4 };
+			const int rows{ 100 };
+			const int cols{ 70 };
+			std::vector<int> visits(rows * cols, 0);
+			std::atomic<bool> tiles_respected{ true };
+			for (Schedule schedule : { Schedule::Static(), Schedule::Dynamic(1) }) {
+				std::fill(visits.begin(), visits.end(), 0);
+				parallel_for(pool, schedule, blocked_range2d<int>{ 0, rows, 16, 0, cols, 32 },
+					[&visits, &tiles_respected, cols](const blocked_range2d<int>& tile) {
+						if (tile.rows().size() > 16 || tile.cols().size() > 32 || tile.rows().begin() % 16 != 0
+																			|| tile.cols().begin() % 32 != 0) {
+							tiles_respected.store(false);
+						}
+						for (int r = tile.rows().begin(); r < tile.rows().end(); ++r) {
+							for (int c = tile.cols().begin(); c < tile.cols().end(); ++c) { ++visits[static_cast<std::size_t>(r * cols + c)]; }
+						}
+					});
+				EXPECT_TRUE(std::all_of(visits.begin(), visits.end(), [](int count) { return count == 1; }));
+			}
+			EXPECT_TRUE(tiles_respected.load());
+		}
+
+		TEST(ParallelForTest, AutoTilesCover3dRangeOnce) {
+			::util::thread::ThreadPool pool{ 3 };
+			std::atomic<long long> sum{ 0 };
+			std::atomic<int> tiles_count{ 0 };
+			parallel_for(pool, blocked_range3d<long long>{ -5, 35, 0, 50, 0, 300 },
+				[&sum, &tiles_count](const blocked_range3d<long long>& tile) {
+					tiles_count.fetch_add(1);
+					long long local_sum{ 0 };
+					for (long long p = tile.pages().begin(); p < tile.pages().end(); ++p) {
+						for (long long r = tile.rows().begin(); r < tile.rows().end(); ++r) {
+							for (long long c = tile.cols().begin(); c < tile.cols().end(); ++c) { local_sum += p; }
+						}
+					}
+					sum.fetch_add(local_sum);
+				});
+			EXPECT_EQ(sum.load(), (34LL * 35 / 2 - 5LL * 6 / 2) * 50 * 300);
+			EXPECT_GE(tiles_count.load(), 3); // outer dimension is divided among threads
+			parallel_for(pool, blocked_range2d<int>{ 5, 5, 0, 10 }, [](const blocked_range2d<int>&) { FAIL(); });
+		}
+
+		TEST(ParallelForTest, CacheTiledFitsBudget) {
+			const blocked_range2d<int> tiled{ cache_tiled(blocked_range2d<int>{ 0, 1000, 0, 1000 }, 8, 32 * 1024) };
+			EXPECT_LE(tiled.rows().grainsize() * tiled.cols().grainsize() * 8, 32 * 1024);
+			EXPECT_EQ(tiled.cols().grainsize() % (kCacheLineSize / 8), 0); // whole cache lines
+			EXPECT_GE(tiled.rows().grainsize(), 16);
+
+			const blocked_range2d<int> narrow{ cache_tiled(blocked_range2d<int>{ 0, 1000, 0, 3 }, 8, 32 * 1024) };
+			EXPECT_EQ(narrow.cols().grainsize(), 3);
+			EXPECT_EQ(narrow.rows().grainsize(), 1000); // budget of short row goes to rows
+
+			const blocked_range2d<int> fixed{ cache_tiled(blocked_range2d<int>{ 0, 100, 7, 0, 100, 0 }, 8, 32 * 1024) };
+			EXPECT_EQ(fixed.rows().grainsize(), 7);
+			EXPECT_GE(DataCacheSize(1), 1024);
+			EXPECT_EQ(DataCacheSize(2, "/nonexistent/cache"), 1024 * 1024);
+		}
+
+//================task====================================================================
+
+		task<int> AddOnPool(::util::thread::ThreadPool& pool, int a, int b) {
+			co_await pool.schedule();
+			EXPECT_NE(pool.current_worker_index(), ::util::thread::ThreadPool::kNotWorker);
+			co_return a + b;
+		}
+
+		task<int> Identity(int value) { co_return value; }
+
+		task<void> Fail(::util::thread::ThreadPool& pool) {
+			co_await pool.schedule();
+			throw std::runtime_error{ "coroutine" };
+		}
+
+		TEST(CoroutineTaskTest, ChainOfTasksOnPool) {
+			::util::thread::ThreadPool pool{ 2 };
+			auto chain = [](::util::thread::ThreadPool& chain_pool) -> task<int> {
+				const int x{ co_await AddOnPool(chain_pool, 1, 2) };
+				co_return co_await AddOnPool(chain_pool, x, 3);
+			};
+			EXPECT_EQ(sync_wait(chain(pool)), 6);
+		}
+
+		TEST(CoroutineTaskTest, SymmetricTransferDoesNotGrowStack) {
+			constexpr long long kCount{ 1'000'000 }; // doesn't depend on tail calls of compiler
+			auto loop = []() -> task<long long> {
+				long long sum{ 0 };
+				for (long long i = 0; i < kCount; ++i) { sum += co_await Identity(static_cast<int>(i)); }
+				co_return sum;
+			};
+			EXPECT_EQ(sync_wait(loop()), kCount * (kCount - 1) / 2);
+		}
+
+		TEST(CoroutineTaskTest, WhenAllCollectsResults) {
+			::util::thread::ThreadPool pool{ 4 };
+			auto [a, b, nothing] = sync_wait(when_all(AddOnPool(pool, 1, 1), Identity(5), []() -> task<void> { co_return; }()));
+			EXPECT_EQ(a, 2);
+			EXPECT_EQ(b, 5);
+			static_cast<void>(nothing);
+
+			std::vector<task<int>> tasks{};
+			for (int i = 0; i < 100; ++i) { tasks.push_back(AddOnPool(pool, i, 0)); }
+			const std::vector<int> results{ sync_wait(when_all(std::move(tasks))) };
+			EXPECT_EQ(std::accumulate(results.begin(), results.end(), 0), 4950);
+		}
+
+		TEST(CoroutineTaskTest, ExceptionIsRethrown) {
+			::util::thread::ThreadPool pool{ 2 };
+			EXPECT_THROW(sync_wait(Fail(pool)), std::runtime_error);
+
+			std::vector<task<void>> tasks{};
+			tasks.push_back(Fail(pool));
+			tasks.push_back([]() -> task<void> { co_return; }());
+			EXPECT_THROW(sync_wait(when_all(std::move(tasks))), std::runtime_error);
+		}
+
+//================combinable==============================================================
+
+		TEST(CombinableTest, PartialSumsOfLoop) {
+			::util::thread::ThreadPool pool{ 4 };
+			combinable<long long> sums{ pool };
+			for_parallel(pool, Schedule::Dynamic(100), [&sums](int i, int imax) {
+				for (; i < imax; ++i) { sums.local() += i; }
+			}, 0, 100'000);
+			EXPECT_EQ(sums.combine(std::plus<>{}), 100'000LL * 99'999 / 2);
+
+			std::size_t instances{ 0 };
+			sums.for_each([&instances](long long&) { ++instances; });
+			EXPECT_GE(instances, 1);
+			EXPECT_LE(instances, pool.size() + 1); // workers and caller thread
+
+			sums.clear();
+			EXPECT_EQ(sums.combine(std::plus<>{}), 0);
+		}
+
+		TEST(CombinableTest, InstanceIsCreatedOncePerThread) {
+			::util::thread::ThreadPool pool{ 2 };
+			std::atomic<int> created{ 0 };
+			combinable<std::vector<int>> buffers{ pool, [&created]() {
+				created.fetch_add(1);
+				return std::vector<int>(16, 0);
+			} };
+			bool exists{ true };
+			EXPECT_EQ(buffers.local(exists).size(), 16);
+			EXPECT_FALSE(exists);
+			buffers.local(exists).push_back(1);
+			EXPECT_TRUE(exists);
+			EXPECT_EQ(buffers.local().size(), 17); // the same instance of caller
+
+			std::thread{ [&buffers]() { buffers.local().push_back(2); } }.join();
+			pool.submit([&buffers]() { buffers.local().push_back(3); }).get();
+			EXPECT_EQ(created.load(), 3);
+
+			const auto total_size{ buffers.combine([](std::vector<int> lhs, const std::vector<int>& rhs) {
+				lhs.insert(lhs.end(), rhs.begin(), rhs.end());
+				return lhs;
+			}).size() };
+			EXPECT_EQ(total_size, 17 + 17 + 17);
+		}
+
+//================CpuTopology=============================================================
+
+		TEST(CpuTopologyTest, ParseCpuList) {
+			EXPECT_EQ(CpuTopology::ParseCpuList("0-3,8-9\n"), (std::vector<unsigned int>{ 0, 1, 2, 3, 8, 9 }));
+			EXPECT_EQ(CpuTopology::ParseCpuList("5"), (std::vector<unsigned int>{ 5 }));
+			EXPECT_EQ(CpuTopology::ParseCpuList("x,2-a,4"), (std::vector<unsigned int>{ 4 }));
+			EXPECT_TRUE(CpuTopology::ParseCpuList("").empty());
+		}
+
+		TEST(CpuTopologyTest, DiscoverFindsCpus) {
+			EXPECT_GE(CpuTopology::Discover().cpus_count(), 1);
+			const CpuTopology fallback{ CpuTopology::Discover("/nonexistent/node") };
+			ASSERT_EQ(fallback.nodes.size(), 1);
+			EXPECT_GE(fallback.cpus_count(), 1);
+		}
+
+		TEST(CpuTopologyTest, FirstTouchArrayIsFilled) {
+			::util::thread::ThreadPool pool{ 4, ::util::thread::WorkerAffinity::kNumaNodes };
+			const std::size_t count{ 100'000 };
+			const auto array{ make_first_touch_array(pool, count, 7) };
+			EXPECT_TRUE(std::all_of(array.get(), array.get() + count, [](int x) { return x == 7; }));
+		}
+
+//================LatencyHistogram========================================================
+
+		TEST(LatencyHistogramTest, BucketsBoundRelativeError) {
+			for (std::uint64_t value : { 0ull, 1ull, 7ull, 8ull, 9ull, 100ull, 12345ull, 1ull << 40, ~0ull }) {
+				const std::size_t index{ LatencyHistogram::BucketIndex(value) };
+				ASSERT_LT(index, LatencyHistogram::kBucketsCount);
+				const std::uint64_t upper{ LatencyHistogram::BucketUpperBound(index) };
+				EXPECT_GE(upper, value);
+				EXPECT_LE(upper - value, value / LatencyHistogram::kSubBucketsCount);
+				if (index > 0) { EXPECT_LT(LatencyHistogram::BucketUpperBound(index - 1), value); }
+			}
+		}
+
+		TEST(LatencyHistogramTest, Percentiles) {
+			LatencyHistogram histogram{};
+			EXPECT_EQ(histogram.percentile(50), 0);
+			for (std::uint64_t value = 1; value <= 1000; ++value) { histogram.record(value); }
+			EXPECT_EQ(histogram.count(), 1000);
+			EXPECT_EQ(histogram.max(), 1000);
+			EXPECT_DOUBLE_EQ(histogram.mean(), 500.5);
+			EXPECT_NEAR(static_cast<double>(histogram.percentile(50)), 500.0, 500.0 / LatencyHistogram::kSubBucketsCount);
+			EXPECT_NEAR(static_cast<double>(histogram.percentile(99)), 990.0, 990.0 / LatencyHistogram::kSubBucketsCount);
+			EXPECT_EQ(histogram.percentile(100), 1000);
+
+			LatencyRecorder recorder{};
+			recorder.record(5);
+			recorder.record(5000);
+			LatencyHistogram merged{ recorder.snapshot() };
+			EXPECT_EQ(merged.count(), 2);
+			EXPECT_EQ(merged.bucket_count(5), 1);
+			merged.merge(histogram);
+			EXPECT_EQ(merged.count(), 1002);
+			EXPECT_EQ(merged.max(), 5000);
+		}
+
+//================MemoryReclamation=======================================================
+
+		/** Counts destroyed objects. Value is checked by readers: freed object would be noticed by sanitizers. */
+		struct ReclaimedNode {
+			ReclaimedNode(int init_value, std::atomic<int>& destroyed) noexcept : value{ init_value }, destroyed_count{ destroyed } {}
+			~ReclaimedNode() { destroyed_count.fetch_add(1); }
+
+			int value;
+			std::atomic<int>& destroyed_count;
+		};
+
+		TEST(EpochDomainTest, PinnedReaderDelaysFree) {
+			std::atomic<int> destroyed{ 0 };
+			EpochDomain domain{};
+			std::latch pinned{ 1 };
+			std::latch unpin{ 1 };
+			std::thread reader{ [&domain, &pinned, &unpin]() {
+				auto guard{ domain.pin() };
+				pinned.count_down();
+				unpin.wait();
+			} };
+			pinned.wait();
+			domain.retire(new ReclaimedNode{ 1, destroyed });
+			for (int i = 0; i < 3; ++i) { domain.collect(); }
+			EXPECT_EQ(destroyed.load(), 0);
+
+			unpin.count_down();
+			reader.join();
+			for (int i = 0; i < 3; ++i) { domain.collect(); }
+			EXPECT_EQ(destroyed.load(), 1);
+		}
+
+		TEST(EpochDomainTest, RetiredObjectsOfExitedThreadAreFreed) {
+			std::atomic<int> destroyed{ 0 };
+			{
+				EpochDomain domain{};
+				std::thread{ [&domain, &destroyed]() {
+					for (int i = 0; i < 10; ++i) { domain.retire(new ReclaimedNode{ i, destroyed }); }
+				} }.join();
+				for (int i = 0; i < 3; ++i) { domain.collect(); }
+				EXPECT_EQ(destroyed.load(), 10);
+
+				std::thread{ [&domain, &destroyed]() { domain.retire(new ReclaimedNode{ 0, destroyed }); } }.join();
+			} // domain frees the rest
+			EXPECT_EQ(destroyed.load(), 11);
+		}
+
+		/** Writer replaces shared node and retires old one, readers read it in critical sections. */
+		template<typename DomainT, typename ReadT>
+		void ReplaceWhileReading(DomainT& domain, ReadT read) {
+			constexpr int kReplaces{ 20'000 };
+			std::atomic<int> destroyed{ 0 };
+			std::atomic<ReclaimedNode*> shared{ new ReclaimedNode{ 0, destroyed } };
+			std::atomic<bool> done{ false };
+			std::vector<std::thread> readers{};
+			for (int i = 0; i < 3; ++i) {
+				readers.emplace_back([&domain, &shared, &done, &read]() {
+					int last{ 0 };
+					while (!done.load()) {
+						const int value{ read(domain, shared) };
+						EXPECT_GE(value, last); // object is alive: value is never stale garbage
+						last = value;
+					}
+				});
+			}
+			for (int i = 1; i <= kReplaces; ++i) {
+				domain.retire(shared.exchange(new ReclaimedNode{ i, destroyed }));
+			}
+			done.store(true);
+			for (auto& reader : readers) { reader.join(); }
+			for (int i = 0; i < 3; ++i) { domain.collect(); }
+			EXPECT_GT(destroyed.load(), kReplaces / 2); // memory is reclaimed by batches during work
+			domain.retire(shared.load());
+			domain.collect();
+			domain.collect();
+			EXPECT_EQ(destroyed.load(), kReplaces + 1);
+		}
+
+		TEST(EpochDomainTest, ReplaceWhileReading) {
+			EpochDomain domain{};
+			ReplaceWhileReading(domain, [](EpochDomain& reader_domain, std::atomic<ReclaimedNode*>& shared) {
+				auto guard{ reader_domain.pin() };
+				return shared.load(std::memory_order_acquire)->value;
+			});
+		}
+
+		TEST(HazardPointerDomainTest, ProtectedObjectIsNotFreed) {
+			std::atomic<int> destroyed{ 0 };
+			HazardPointerDomain domain{};
+			std::atomic<ReclaimedNode*> shared{ new ReclaimedNode{ 1, destroyed } };
+			auto hazard{ domain.make_hazard_pointer() };
+			ReclaimedNode* node{ hazard.protect(shared) };
+			domain.retire(shared.exchange(nullptr));
+			domain.collect();
+			EXPECT_EQ(destroyed.load(), 0);
+			EXPECT_EQ(node->value, 1);
+
+			hazard.reset();
+			domain.collect();
+			EXPECT_EQ(destroyed.load(), 1);
+
+			static_assert(HazardPointerDomain::kHazardsCount == 4);
+			auto second{ domain.make_hazard_pointer() };
+			auto third{ domain.make_hazard_pointer() };
+			auto fourth{ domain.make_hazard_pointer() };
+			EXPECT_THROW(static_cast<void>(domain.make_hazard_pointer()), std::length_error);
+		}
+
+		TEST(HazardPointerDomainTest, ReplaceWhileReading) {
+			HazardPointerDomain domain{};
+			ReplaceWhileReading(domain, [](HazardPointerDomain& reader_domain, std::atomic<ReclaimedNode*>& shared) {
+				auto hazard{ reader_domain.make_hazard_pointer() };
+				return hazard.protect(shared)->value;
+			});
+		}
+
+//================SlotAllocator===========================================================
+
+		TEST(SlotAllocatorTest, FreedSlotsAreReused) {
+			using Slots = SlotAllocator<128>;
+			std::vector<void*> slots(10);
+			for (void*& slot : slots) { slot = Slots::Allocate(); }
+			EXPECT_EQ(reinterpret_cast<std::uintptr_t>(slots[0]) % kCacheLineSize, 0);
+			for (void* slot : slots) { Slots::Deallocate(slot); }
+			std::vector<void*> reused(slots.size());
+			for (void*& slot : reused) { slot = Slots::Allocate(); }
+			std::sort(slots.begin(), slots.end());
+			std::sort(reused.begin(), reused.end());
+			EXPECT_EQ(slots, reused);
+			for (void* slot : reused) { Slots::Deallocate(slot); }
+		}
+
+		TEST(SlotAllocatorTest, SlotsMoveBetweenThreads) {
+			using Slots = SlotAllocator<128>;
+			SpscQueue<void*> queue{ 1024 };
+			constexpr int kSlots{ 100'000 };
+			std::thread consumer{ [&queue]() { // frees slots of producer
+				for (int i = 0; i < kSlots;) {
+					if (auto slot{ queue.try_pop() }) {
+						static_cast<int*>(*slot)[0] = i;
+						Slots::Deallocate(*slot);
+						++i;
+					} else {
+						std::this_thread::yield();
+					}
+				}
+			} };
+			std::unordered_set<void*> addresses{};
+			for (int i = 0; i < kSlots; ++i) {
+				void* slot{ Slots::Allocate() };
+				addresses.insert(slot);
+				while (!queue.try_push(slot)) { std::this_thread::yield(); }
+			}
+			consumer.join();
+			// slots freed by consumer return to producer: only slots in queue and in caches of threads are new
+			EXPECT_LT(addresses.size(), queue.capacity() + 8 * Slots::kBatchSize);
+		}
+
+//================SpscQueue===============================================================
+
+		TEST(SpscQueueTest, FullAndEmpty) {
+			SpscQueue<int> queue{ 5 };
+			EXPECT_EQ(queue.capacity(), 8);
+			const std::vector<int> values{ 1, 2, 3, 4, 5, 6 };
+			EXPECT_EQ(queue.push_batch(values), 6);
+			EXPECT_EQ(queue.push_batch(values), 2); // only free space is filled
+			EXPECT_FALSE(queue.try_push(7));
+			EXPECT_EQ(queue.try_pop(), 1);
+
+			std::vector<int> popped(10);
+			EXPECT_EQ(queue.pop_batch(popped), 7); // crosses the end of ring
+			EXPECT_EQ(std::vector<int>(popped.begin(), popped.begin() + 7), (std::vector<int>{ 2, 3, 4, 5, 6, 1, 2 }));
+			EXPECT_FALSE(queue.try_pop().has_value());
+			EXPECT_TRUE(queue.empty());
+		}
+
+		TEST(SpscQueueTest, ProducerConsumerKeepOrder) {
+			constexpr int kValues{ 200'000 };
+			SpscQueue<int> queue{ 256 };
+			std::thread producer{ [&queue]() {
+				std::vector<int> batch(37);
+				for (int value = 0; value < kValues;) {
+					const int count{ std::min(static_cast<int>(batch.size()), kValues - value) };
+					std::iota(batch.begin(), batch.begin() + count, value);
+					std::span<const int> rest{ batch.data(), static_cast<std::size_t>(count) };
+					while (!rest.empty()) {
+						const std::size_t pushed{ queue.push_batch(rest) };
+						if (pushed == 0) { std::this_thread::yield(); }
+						rest = rest.subspan(pushed);
+					}
+					value += count;
+					if (value < kValues && queue.try_push(value)) { ++value; }
+				}
+			} };
+
+			bool ordered{ true };
+			std::vector<int> batch(50);
+			for (int expected = 0; expected < kValues;) {
+				const std::size_t count{ queue.pop_batch(batch) };
+				if (count == 0) { std::this_thread::yield(); }
+				for (std::size_t i = 0; i < count; ++i) { ordered = ordered && batch[i] == expected++; }
+			}
+			producer.join();
+			EXPECT_TRUE(ordered);
+			EXPECT_TRUE(queue.empty());
+		}
+
+//================WorkStealingDeque=======================================================
+
+		TEST(WorkStealingDequeTest, OwnerLifoThiefFifo) {
+			WorkStealingDeque<int> deque{ 2 };
+			for (int i = 0; i < 10; ++i) { deque.push(i); } // grows
+			EXPECT_EQ(deque.size(), 10);
+			EXPECT_EQ(deque.pop(), 9);
+			EXPECT_EQ(deque.steal(), 0);
+			EXPECT_EQ(deque.pop(), 8);
+			EXPECT_EQ(deque.steal(), 1);
+			while (deque.pop()) {}
+			EXPECT_FALSE(deque.steal().has_value());
+			EXPECT_TRUE(deque.empty());
+		}
+
+		TEST(WorkStealingDequeTest, EveryItemTakenOnce) {
+			constexpr int kItems{ 100'000 };
+			WorkStealingDeque<int> deque{};
+			std::vector<std::atomic<int>> taken(kItems);
+			std::atomic<bool> done{ false };
+			std::vector<std::thread> thieves{};
+			for (int t = 0; t < 3; ++t) {
+				thieves.emplace_back([&]() {
+					while (!done.load() || !deque.empty()) {
+						if (auto item{ deque.steal() }) {
+							taken[static_cast<std::size_t>(*item)].fetch_add(1);
+						} else {
+							std::this_thread::yield();
+						}
+					}
+				});
+			}
+			for (int i = 0; i < kItems; ++i) {
+				deque.push(i);
+				if (i % 3 == 0) {
+					if (auto item{ deque.pop() }) { taken[static_cast<std::size_t>(*item)].fetch_add(1); }
+				}
+			}
+			done.store(true);
+			while (auto item{ deque.pop() }) { taken[static_cast<std::size_t>(*item)].fetch_add(1); }
+			for (auto& thief : thieves) { thief.join(); }
+			EXPECT_TRUE(std::all_of(taken.begin(), taken.end(), [](const auto& count) { return count.load() == 1; }));
+		}
+
+//================task_group==============================================================
+
+		long long Fib(::util::thread::ThreadPool& pool, int n) {
+			if (n < 12) { return n < 2 ? n : Fib(pool, n - 1) + Fib(pool, n - 2); }
+			long long a{}, b{};
+			task_group group{ pool };
+			group.run([&pool, &a, n]() { a = Fib(pool, n - 1); });
+			b = Fib(pool, n - 2);
+			group.wait();
+			return a + b;
+		}
+
+		TEST(TaskGroupTest, RecursiveTasksOnSmallPool) {
+			::util::thread::ThreadPool pool{ 2 };
+			EXPECT_EQ(pool.enqueue([&pool]() { return Fib(pool, 25); }).get(), 75025);
+			EXPECT_EQ(Fib(pool, 24), 46368);
+		}
+
+		TEST(TaskGroupTest, WaitRethrowsFirstException) {
+			::util::thread::ThreadPool pool{ 4 };
+			task_group group{ pool };
+			std::atomic<int> executed{ 0 };
+			for (int i = 0; i < 100; ++i) {
+				group.run([&executed, i]() {
+					executed.fetch_add(1);
+					if (i % 10 == 0) { throw std::runtime_error{ "task" }; }
+				});
+			}
+			EXPECT_THROW(group.wait(), std::runtime_error);
+			EXPECT_EQ(executed.load(), 100);
+
+			group.run([&executed]() { executed.fetch_add(1); });
+			EXPECT_NO_THROW(group.wait()); // group is reusable
+			EXPECT_EQ(executed.load(), 101);
+
+			group.run([]() { throw std::logic_error{ "next task" }; });
+			EXPECT_THROW(group.wait(), std::logic_error); // exception after reuse isn't lost
+		}
+
+		TEST(TaskGroupTest, NestedParallelLoops) {
+			::util::thread::ThreadPool pool{ 3 };
+			std::atomic<long long> counter{ 0 };
+			for_parallel(pool, Schedule::Dynamic(1), [&pool, &counter](int i, int imax) {
+				for (; i < imax; ++i) {
+					for_parallel(pool, [&counter](int j, int jmax) { counter.fetch_add(jmax - j); }, 0, 1000);
+				}
+			}, 0, 50);
+			EXPECT_EQ(counter.load(), 50'000);
+		}
+
+//================TimerWheel==============================================================
+
+		TEST(TimerWheelTest, FiresNotBeforeTime) {
+			::util::thread::ThreadPool pool{ 2 };
+			TimerWheel wheel{ pool };
+			using Clock = TimerWheel::Clock;
+			const Clock::time_point start{ Clock::now() };
+			std::array<std::promise<Clock::time_point>, 3> fired{};
+			const std::array<std::chrono::milliseconds, 3> delays{ std::chrono::milliseconds{ 5 },
+							std::chrono::milliseconds{ 300 }, std::chrono::milliseconds{ 0 } }; // 300 ticks - level 1
+			for (std::size_t i = 0; i < delays.size(); ++i) {
+				wheel.schedule_after(delays[i], [&fired, i]() { fired[i].set_value(Clock::now()); });
+			}
+			for (std::size_t i = 0; i < delays.size(); ++i) {
+				EXPECT_GE(fired[i].get_future().get() - start, delays[i]);
+			}
+			EXPECT_EQ(wheel.size(), 0);
+		}
+
+		TEST(TimerWheelTest, CancelledTimersDontFire) {
+			::util::thread::ThreadPool pool{ 2 };
+			TimerWheel wheel{ pool };
+			std::atomic<int> fired_count{ 0 };
+			std::vector<TimerWheel::TimerId> cancelled{};
+			for (int i = 0; i < 10'000; ++i) {
+				cancelled.push_back(wheel.schedule_after(std::chrono::seconds{ 10 } + std::chrono::milliseconds{ i },
+														[&fired_count]() { fired_count.fetch_add(1000); }));
+			}
+			std::promise<void> last{};
+			const TimerWheel::TimerId fired{ wheel.schedule_after(std::chrono::milliseconds{ 10 },
+														[&fired_count]() { fired_count.fetch_add(1); }) };
+			wheel.schedule_after(std::chrono::milliseconds{ 20 }, [&last]() { last.set_value(); });
+			EXPECT_EQ(wheel.size(), 10'002);
+
+			for (TimerWheel::TimerId timer : cancelled) { EXPECT_TRUE(wheel.cancel(timer)); }
+			EXPECT_FALSE(wheel.cancel(cancelled[1])); // cancelled already
+			EXPECT_FALSE(wheel.cancel(TimerWheel::kInvalidTimer));
+			last.get_future().wait();
+			EXPECT_EQ(wheel.size(), 0);
+			EXPECT_FALSE(wheel.cancel(fired)); // fired already
+			while (fired_count.load() == 0) { std::this_thread::yield(); } // posted before the last one
+			EXPECT_EQ(fired_count.load(), 1);
+		}
+
+		TEST(TimerWheelTest, PeriodicFiresUntilCancel) {
+			::util::thread::ThreadPool pool{ 2 };
+			TimerWheel wheel{ pool };
+			std::atomic<int> fired_count{ 0 };
+			const TimerWheel::TimerId timer{ wheel.schedule_every(std::chrono::milliseconds{ 2 },
+															[&fired_count]() { fired_count.fetch_add(1); }) };
+			while (fired_count.load() < 5) { std::this_thread::sleep_for(std::chrono::milliseconds{ 1 }); }
+			EXPECT_TRUE(wheel.cancel(timer));
+			EXPECT_EQ(wheel.size(), 0);
+			EXPECT_FALSE(wheel.cancel(timer));
+		}
+
+		TEST(TimerWheelTest, PeriodicDoesntFireAfterCancel) {
+			::util::thread::ThreadPool pool{ 1 }; // calls, that were posted before cancel, wait in queue
+			TimerWheel wheel{ pool };
+			std::atomic<int> fired_count{ 0 };
+			std::atomic<TimerWheel::TimerId> timer{ TimerWheel::kInvalidTimer };
+			std::promise<void> cancelled{};
+			timer.store(wheel.schedule_every(std::chrono::milliseconds{ 1 }, [&]() {
+				if (fired_count.fetch_add(1) + 1 == 5) {
+					while (timer.load() == TimerWheel::kInvalidTimer) { std::this_thread::yield(); }
+					std::this_thread::sleep_for(std::chrono::milliseconds{ 5 }); // next calls are posted meanwhile
+					EXPECT_TRUE(wheel.cancel(timer.load()));
+					cancelled.set_value();
+				}
+			}));
+			cancelled.get_future().wait();
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+			pool.enqueue([]() {}).get();
+			EXPECT_EQ(fired_count.load(), 5);
+		}
+
+		TEST(TimerWheelTest, EarlyTimerWakesSleepingTickThread) {
+			::util::thread::ThreadPool pool{ 2 };
+			TimerWheel wheel{ pool };
+			using Clock = TimerWheel::Clock;
+			wheel.schedule_after(std::chrono::seconds{ 100 }, []() {}); // tick thread sleeps until its cascade
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+			const Clock::time_point start{ Clock::now() };
+			std::promise<Clock::time_point> fired{};
+			wheel.schedule_after(std::chrono::milliseconds{ 5 }, [&fired]() { fired.set_value(Clock::now()); });
+			const Clock::duration delay{ fired.get_future().get() - start };
+			EXPECT_GE(delay, std::chrono::milliseconds{ 5 });
+			EXPECT_LT(delay, std::chrono::seconds{ 1 });
+			EXPECT_EQ(wheel.size(), 1);
+		}
+
+//================future==================================================================
+
+		TEST(FutureTest, ThenRunsAfterTask) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::promise<void> gate{};
+			std::shared_future<void> opened{ gate.get_future().share() };
+			future<int> first{ pool.submit([opened]() { opened.wait(); return 20; }) };
+			future<int> second{ first.then([](future<int>&& ready) { return ready.get() + 1; }) };
+			EXPECT_FALSE(first.valid());
+			future<std::string> third{ std::move(second).then([](future<int>&& ready) {
+				return std::to_string(ready.get() * 2);
+			}) };
+			gate.set_value();
+			EXPECT_EQ(third.get(), "42");
+		}
+
+		TEST(FutureTest, ThenOnReadyFutureRunsInline) {
+			const std::thread::id caller{ std::this_thread::get_id() };
+			std::thread::id executor{};
+			future<int> result{ make_ready_future(5).then([&executor](future<int>&& ready) {
+				executor = std::this_thread::get_id();
+				return ready.get() * 2;
+			}) };
+			EXPECT_TRUE(result.is_ready());
+			EXPECT_EQ(executor, caller);
+			EXPECT_EQ(result.get(), 10);
+			EXPECT_TRUE(make_ready_future().is_ready());
+		}
+
+		TEST(FutureTest, ExceptionPassesThroughThen) {
+			::util::thread::ThreadPool pool{ 2 };
+			future<int> failed{ pool.submit([]() -> int { throw std::runtime_error{ "task error" }; }) };
+			future<bool> handled{ failed.then([](future<int>&& ready) {
+				try {
+					static_cast<void>(ready.get());
+				} catch (const std::runtime_error&) {
+					return true;
+				}
+				return false;
+			}) };
+			EXPECT_TRUE(handled.get());
+		}
+
+		TEST(FutureTest, WhenAllWaitsEveryFuture) {
+			::util::thread::ThreadPool pool{ 4 };
+			std::vector<future<int>> futures{};
+			for (int i = 0; i < 100; ++i) { futures.push_back(pool.submit([i]() { return i; })); }
+			std::vector<future<int>> ready{ when_all(std::move(futures)).get() };
+			ASSERT_EQ(ready.size(), 100);
+			int sum{ 0 };
+			for (future<int>& value : ready) {
+				EXPECT_TRUE(value.is_ready());
+				sum += value.get();
+			}
+			EXPECT_EQ(sum, 4950);
+			EXPECT_TRUE(when_all(std::vector<future<int>>{}).get().empty());
+
+			auto [number, text, done] = when_all(pool.submit([]() { return 1; }),
+												pool.submit([]() { return std::string{ "two" }; }),
+												make_ready_future()).get();
+			EXPECT_EQ(number.get(), 1);
+			EXPECT_EQ(text.get(), "two");
+			EXPECT_NO_THROW(done.get());
+		}
+
+		TEST(FutureTest, WhenAnyReturnsFirstReady) {
+			::util::thread::ThreadPool pool{ 2 };
+			std::promise<void> gate{};
+			std::shared_future<void> opened{ gate.get_future().share() };
+			std::vector<future<int>> futures{};
+			futures.push_back(pool.submit([opened]() { opened.wait(); return 0; }));
+			futures.push_back(make_ready_future(1));
+			futures.push_back(pool.submit([opened]() { opened.wait(); return 2; }));
+
+			when_any_result<std::vector<future<int>>> any{ when_any(std::move(futures)).get() };
+			EXPECT_EQ(any.index, 1);
+			EXPECT_EQ(any.futures[1].get(), 1);
+			gate.set_value();
+			EXPECT_EQ(any.futures[0].get(), 0);
+			EXPECT_EQ(any.futures[2].get(), 2);
+
+			EXPECT_EQ(when_any(std::vector<future<int>>{}).get().index, static_cast<std::size_t>(-1));
+		}
+
+	} // !namespace conc
+
+
+	namespace generic {
+		using namespace ::generic;
+
+//================generic::Sort===========================================================
+
+		TEST(GenericSortTest, SequentialAndParallelSortLikeStd) {
+			std::vector<int> values(100'003);
+			for (std::size_t i = 0; i < values.size(); ++i) { values[i] = static_cast<int>((i * 7919) % 1009); }
+			std::vector<int> expected{ values };
+			std::sort(expected.begin(), expected.end());
+
+			std::vector<int> sequential{ values };
+			Sort(sequential);
+			EXPECT_EQ(sequential, expected);
+
+			std::vector<int> parallel{ values };
+			Sort(parallel, std::execution::par);
+			EXPECT_EQ(parallel, expected);
+
+			std::sort(expected.begin(), expected.end(), std::greater<>{});
+			Sort(parallel, std::execution::par_unseq, std::greater<>{});
+			EXPECT_EQ(parallel, expected);
+		}
+
+		TEST(GenericSortTest, ListsSortThemselves) {
+			std::list<int> list{ 3, 1, 2 };
+			Sort(list, std::execution::par); // nodes are relinked by list::sort
+			EXPECT_EQ(list, (std::list<int>{ 1, 2, 3 }));
+
+			std::forward_list<int> forward_list{ 1, 3, 2 };
+			Sort(forward_list, std::execution::seq, std::greater<>{});
+			EXPECT_EQ(forward_list, (std::forward_list<int>{ 3, 2, 1 }));
+		}
+
+//================generic::Find===========================================================
+
+		TEST(GenericFindTest, ParallelFindReturnsFirstMatch) {
+			std::vector<int> values(300'000, 0);
+			values[123'456] = 7;
+			values[20'000] = 7;
+			values[250'000] = 7;
+			const auto sequential{ Find(values, 7) };
+			const auto parallel{ Find(values, 7, std::execution::par) };
+			EXPECT_EQ(sequential - values.cbegin(), 20'000);
+			EXPECT_EQ(parallel, sequential);
+			EXPECT_EQ(Find(values, 8, std::execution::par_unseq), values.cend());
+		}
+
+		TEST(GenericFindTest, AssociativeContainersUseOwnFind) {
+			const std::set<int> set{ 1, 2, 3 };
+			EXPECT_EQ(*Find(set, 2), 2);
+			EXPECT_EQ(Find(set, 4), set.end());
+
+			const std::map<int, std::string> map{ { 1, "one" }, { 2, "two" } };
+			EXPECT_EQ(Find(map, { 2, "two" })->first, 2);
+			EXPECT_EQ(Find(map, { 2, "three" }), map.end()); // key matches, value doesn't
+		}
+
+		TEST(GenericFindTest, FindEqualOwnerWithParallelPolicy) {
+			std::vector<std::shared_ptr<int>> owners{};
+			std::vector<std::weak_ptr<int>> pointers{};
+			for (int i = 0; i < 100'000; ++i) {
+				owners.push_back(std::make_shared<int>(i));
+				pointers.push_back(owners.back());
+			}
+			pointers.push_back(owners[40'000]); // the same owner later
+			const std::weak_ptr<int> searched{ owners[40'000] };
+			const auto found{ ::util::FindEqualOwner(pointers, searched, std::execution::par) };
+			EXPECT_EQ(found - pointers.cbegin(), 40'000); // the first of equal owners
+			EXPECT_EQ(found, ::util::FindEqualOwner(pointers, searched, std::execution::seq));
+
+			const std::weak_ptr<int> expired{ std::make_shared<int>(-1) };
+			EXPECT_EQ(::util::FindEqualOwner(pointers, expired, std::execution::par), pointers.cend());
+		}
+
+	} // !namespace generic
+
+}  // !unnamed namespace